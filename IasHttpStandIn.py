@@ -0,0 +1,122 @@
+#A plain HTTP stand-in of the IAS attestation API, for testing the curl based IAS connectors of Decent Server
+#	without reaching Intel. Point "SgxServiceProvider.IasUrl" to http://ADDR:PORT/attestation/v3 .
+#It checks the subscription key header, answers SigRL requests with an empty SigRL, and report requests with a
+#	report echoing the request's nonce (which IAS would sign; the signature here is a placeholder, so the report
+#	doesn't pass verification). New connections are counted, so connection reuse can be observed.
+
+import sys
+import json
+import time
+import signal
+import base64
+import argparse
+import threading
+import http.server
+
+gs_apiPrefix = "/attestation/v3"
+
+gs_connectionCount = 0
+gs_requestCount = 0
+gs_countLock = threading.Lock()
+
+class IasRequestHandler(http.server.BaseHTTPRequestHandler):
+	#Keep-alive, as IAS does.
+	protocol_version = "HTTP/1.1"
+
+	def setup(self):
+		global gs_connectionCount
+		super().setup()
+		with gs_countLock:
+			gs_connectionCount += 1
+
+	def log_message(self, format, *args):
+		if self.server.isVerbose:
+			super().log_message(format, *args)
+
+	def SendResp(self, status, body = b"", headers = {}):
+		global gs_requestCount
+		with gs_countLock:
+			gs_requestCount += 1
+		self.send_response(status)
+		for name, value in headers.items():
+			self.send_header(name, value)
+		self.send_header("Content-Length", str(len(body)))
+		self.end_headers()
+		self.wfile.write(body)
+
+	def IsAuthorized(self):
+		return len(self.headers.get("Ocp-Apim-Subscription-Key", "")) > 0
+
+	#Pre-warming sends HEAD to the base URL; any response keeps the connection.
+	def do_HEAD(self):
+		self.SendResp(404)
+
+	def do_GET(self):
+		if not self.IsAuthorized():
+			self.SendResp(401)
+		elif self.path.startswith(gs_apiPrefix + "/sigrl/") and len(self.path) == len(gs_apiPrefix + "/sigrl/") + 8:
+			self.SendResp(200)
+		else:
+			self.SendResp(404)
+
+	def do_POST(self):
+		body = self.rfile.read(int(self.headers.get("Content-Length", "0")))
+		if not self.IsAuthorized():
+			self.SendResp(401)
+			return
+		if self.path != gs_apiPrefix + "/report":
+			self.SendResp(404)
+			return
+
+		try:
+			req = json.loads(body)
+			quote = req["isvEnclaveQuote"]
+		except (ValueError, KeyError, TypeError):
+			self.SendResp(400)
+			return
+
+		report = {
+			"id" : str(gs_requestCount),
+			"timestamp" : time.strftime("%Y-%m-%dT%H:%M:%S.000000", time.gmtime()),
+			"version" : 3,
+			"isvEnclaveQuoteStatus" : "OK",
+			"isvEnclaveQuoteBody" : quote[:576],
+		}
+		if "nonce" in req:
+			report["nonce"] = req["nonce"]
+
+		time.sleep(self.server.reportDelay)
+		self.SendResp(200, json.dumps(report).encode(), {
+			"Content-Type" : "application/json",
+			"X-IASReport-Signature" : base64.b64encode(b"\0" * 256).decode(),
+			"X-IASReport-Signing-Certificate" : "-----BEGIN%20CERTIFICATE-----%0A-----END%20CERTIFICATE-----%0A",
+		})
+
+def OnTerminate(signum, frame):
+	raise KeyboardInterrupt()
+
+def main():
+	parser = argparse.ArgumentParser(description = "Plain HTTP stand-in of the IAS attestation API.")
+	parser.add_argument("-a", "--addr", default = "127.0.0.1", help = "Address to listen on.")
+	parser.add_argument("-p", "--port", type = int, default = 57780, help = "Port to listen on.")
+	parser.add_argument("-d", "--delay", type = float, default = 0.0, help = "Delay of report responses, in seconds.")
+	parser.add_argument("-v", "--verbose", action = "store_true", help = "Log every request.")
+	args = parser.parse_args()
+
+	server = http.server.ThreadingHTTPServer((args.addr, args.port), IasRequestHandler)
+	server.daemon_threads = True
+	server.reportDelay = args.delay
+	server.isVerbose = args.verbose
+
+	signal.signal(signal.SIGTERM, OnTerminate)
+
+	sys.stdout.write("IAS stand-in on http://%s:%d%s\n" % (args.addr, args.port, gs_apiPrefix))
+	sys.stdout.flush()
+	try:
+		server.serve_forever()
+	except KeyboardInterrupt:
+		pass
+	sys.stdout.write("Connections: %d, requests: %d.\n" % (gs_connectionCount, gs_requestCount))
+
+if __name__ == "__main__":
+	main()
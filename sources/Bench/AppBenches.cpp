@@ -0,0 +1,203 @@
+#include "AppBenches.h"
+
+#include <memory>
+#include <thread>
+#include <stdexcept>
+
+#include <DecentApi/Common/Net/RpcWriter.h>
+#include <DecentApi/Common/Net/ConnectionBase.h>
+#include <DecentApi/CommonApp/Net/TCPConnection.h>
+#include <DecentApi/CommonApp/Net/TCPServer.h>
+#include <DecentApi/CommonApp/Tools/DiskFile.h>
+#include <DecentApi/DecentServerApp/SGX/DecentServerConfig.h>
+
+#include "../IasSim/IasRespSamples.h"
+#include "../app/AppConfig.h"
+
+#include "BenchSuite.h"
+
+using namespace Decent;
+using namespace Decent::Bench;
+using namespace Decent::Net;
+
+namespace
+{
+	static constexpr char const gsk_loopbackIp[] = "127.0.0.1";
+	static constexpr char const gsk_ack[] = "OK";
+
+	static size_t GetReportRpcSize()
+	{
+		return RpcWriter::CalcSizeStr(sizeof(IasSim::gsk_report) - 1) +
+			RpcWriter::CalcSizeStr(sizeof(IasSim::gsk_signature) - 1) +
+			RpcWriter::CalcSizeStr(sizeof(IasSim::gsk_cert) - 1);
+	}
+
+	/** \brief	Builds a report response, the largest RPC message of the simulated IAS. */
+	static RpcWriter BuildReportRpc()
+	{
+		RpcWriter rpc(GetReportRpcSize(), 3);
+
+		auto reportStr = rpc.AddStringArg(sizeof(IasSim::gsk_report) - 1);
+		auto signStr = rpc.AddStringArg(sizeof(IasSim::gsk_signature) - 1);
+		auto certStr = rpc.AddStringArg(sizeof(IasSim::gsk_cert) - 1);
+
+		reportStr.Fill(IasSim::gsk_report);
+		signStr.Fill(IasSim::gsk_signature);
+		certStr.Fill(IasSim::gsk_cert);
+		return rpc;
+	}
+
+	static std::string ReadFile(const std::string& path)
+	{
+		Tools::DiskFile file(path, Tools::FileBase::Mode::Read, true);
+		std::string res;
+		res.resize(file.GetFileSize());
+		file.ReadBlockExactSize(res);
+		return res;
+	}
+
+	/**
+	 * \brief	A loopback TCP connection, whose far end drains messages. For each batch, the number of
+	 * 			messages is sent first, and the far end acknowledges once it has received all of them.
+	 */
+	class LoopbackPair
+	{
+	public:
+		LoopbackPair(uint16_t port) :
+			m_server(TCPConnection::GetIpAddressFromStr(gsk_loopbackIp), port),
+			m_client(),
+			m_drain()
+		{
+			std::unique_ptr<ConnectionBase> farEnd;
+			std::thread acceptor([this, &farEnd]()
+			{
+				farEnd = m_server.AcceptConnection();
+			});
+			try
+			{
+				m_client = std::make_unique<TCPConnection>(TCPConnection::GetIpAddressFromStr(gsk_loopbackIp), port);
+			}
+			catch (...)
+			{
+				m_server.Terminate();
+				acceptor.join();
+				throw;
+			}
+			acceptor.join();
+			if (!farEnd)
+			{
+				throw std::runtime_error("Failed to accept the loopback connection.");
+			}
+
+			m_drain = std::thread([](std::unique_ptr<ConnectionBase> connection)
+			{
+				try
+				{
+					while (true)
+					{
+						const uint64_t count = std::stoull(connection->RecvContainer<std::string>());
+						for (uint64_t i = 0; i < count; ++i)
+						{
+							connection->RecvContainer<std::vector<uint8_t> >();
+						}
+						connection->SendContainer(std::string(gsk_ack));
+					}
+				}
+				catch (const std::exception&)
+				{
+					//The near end is closed.
+				}
+			}, std::move(farEnd));
+		}
+
+		~LoopbackPair()
+		{
+			m_client.reset();
+			m_server.Terminate();
+			m_drain.join();
+		}
+
+		void SendBatch(const RpcWriter& rpc, uint64_t count)
+		{
+			m_client->SendContainer(std::to_string(count));
+			for (uint64_t i = 0; i < count; ++i)
+			{
+				m_client->SendRpc(rpc);
+			}
+			if (m_client->RecvContainer<std::string>() != gsk_ack)
+			{
+				throw std::runtime_error("Unexpected reply on the loopback connection.");
+			}
+		}
+
+	private:
+		TCPServer m_server;
+		std::unique_ptr<ConnectionBase> m_client;
+		std::thread m_drain;
+	};
+}
+
+void Bench::RunAppBenches(BenchSuite & suite, const std::string & configPath, uint16_t loopbackPort)
+{
+	suite.Run("Rpc.BuildReport", 10000, [](uint64_t ops)
+	{
+		for (uint64_t i = 0; i < ops; ++i)
+		{
+			BuildReportRpc();
+		}
+	});
+
+	if (suite.IsSelected("Rpc.SendLoopback"))
+	{
+		std::unique_ptr<LoopbackPair> loopback;
+		std::string setupError;
+		try
+		{
+			loopback = std::make_unique<LoopbackPair>(loopbackPort);
+		}
+		catch (const std::exception& e)
+		{
+			setupError = e.what();
+		}
+
+		const RpcWriter rpc = BuildReportRpc();
+		Json::Value info;
+		info["Bytes"] = static_cast<Json::UInt64>(GetReportRpcSize());
+		suite.Run("Rpc.SendLoopback", 1000, [&loopback, &setupError, &rpc](uint64_t ops)
+		{
+			if (!loopback)
+			{
+				throw std::runtime_error("Failed to set up the loopback connection. " + setupError);
+			}
+			loopback->SendBatch(rpc, ops);
+		}, info);
+	}
+
+	if (suite.IsSelected("Config.Parse"))
+	{
+		std::string configStr;
+		std::string readError;
+		try
+		{
+			configStr = ReadFile(configPath);
+		}
+		catch (const std::exception& e)
+		{
+			readError = e.what();
+		}
+
+		//Both configurations are parsed from the same file at startup.
+		suite.Run("Config.Parse", 1000, [&configStr, &readError](uint64_t ops)
+		{
+			if (configStr.empty())
+			{
+				throw std::runtime_error("Failed to read the configuration file. " + readError);
+			}
+			for (uint64_t i = 0; i < ops; ++i)
+			{
+				Sgx::DecentServerConfig decentConfig(configStr);
+				ServerApp::AppConfig appConfig(configStr);
+			}
+		});
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+namespace Decent
+{
+	namespace Bench
+	{
+		class BenchSuite;
+
+		/**
+		 * \brief	Runs the benchmarks of the untrusted side: building RPC messages, sending them over a
+		 * 			loopback TCP connection, and parsing the configuration file.
+		 *
+		 * \param [in,out]	suite	   	The suite.
+		 * \param 		  	configPath 	Path to the configuration file.
+		 * \param 		  	loopbackPort	The port used for the loopback connection.
+		 */
+		void RunAppBenches(BenchSuite& suite, const std::string& configPath, uint16_t loopbackPort);
+	}
+}
@@ -0,0 +1,98 @@
+#include "BenchSuite.h"
+
+#include <cmath>
+#include <numeric>
+#include <iostream>
+#include <algorithm>
+
+using namespace Decent;
+using namespace Decent::Bench;
+
+constexpr unsigned int BenchSuite::sk_formatVersion;
+
+BenchSuite::BenchSuite(size_t samples, double opsScale, const std::string & filter) :
+	m_samples(std::max<size_t>(samples, 1)),
+	m_opsScale(opsScale > 0.0 ? opsScale : 1.0),
+	m_filter(filter),
+	m_results(),
+	m_failedCnt(0)
+{
+}
+
+BenchSuite::~BenchSuite()
+{
+}
+
+void BenchSuite::Run(const std::string & name, uint64_t opsPerSample, Body body, const Json::Value & info)
+{
+	if (!IsSelected(name))
+	{
+		return;
+	}
+
+	const uint64_t ops = std::max<uint64_t>(static_cast<uint64_t>(opsPerSample * m_opsScale), 1);
+
+	Json::Value result = info.isObject() ? info : Json::Value(Json::objectValue);
+	result["Name"] = name;
+	result["Unit"] = "ns";
+	result["OpsPerSample"] = static_cast<Json::UInt64>(ops);
+
+	std::cerr << "Running " << name << "..." << std::endl;
+	try
+	{
+		//Warm-up; its result is not used.
+		body(ops);
+
+		std::vector<double> perOp;
+		perOp.reserve(m_samples);
+		for (size_t i = 0; i < m_samples; ++i)
+		{
+			const Clock::time_point start = Clock::now();
+			body(ops);
+			perOp.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ops);
+		}
+
+		std::sort(perOp.begin(), perOp.end());
+		const double mean = std::accumulate(perOp.begin(), perOp.end(), 0.0) / perOp.size();
+		double variance = 0.0;
+		for (double sample : perOp)
+		{
+			variance += (sample - mean) * (sample - mean);
+		}
+		variance /= perOp.size();
+
+		const size_t mid = perOp.size() / 2;
+		result["Mean"] = mean;
+		result["Min"] = perOp.front();
+		result["Median"] = perOp.size() % 2 == 0 ? (perOp[mid - 1] + perOp[mid]) / 2.0 : perOp[mid];
+		result["Max"] = perOp.back();
+		result["StdDev"] = std::sqrt(variance);
+	}
+	catch (const std::exception& e)
+	{
+		result["Error"] = e.what();
+		++m_failedCnt;
+	}
+
+	m_results.push_back(result);
+}
+
+bool BenchSuite::IsSelected(const std::string & name) const
+{
+	return m_filter.empty() || name.find(m_filter) != std::string::npos;
+}
+
+Json::Value BenchSuite::ToJson() const
+{
+	Json::Value root;
+	root["FormatVersion"] = sk_formatVersion;
+	root["Samples"] = static_cast<Json::UInt64>(m_samples);
+
+	Json::Value& results = root["Results"];
+	results = Json::Value(Json::arrayValue);
+	for (const Json::Value& result : m_results)
+	{
+		results.append(result);
+	}
+	return root;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+#include <json/json.h>
+
+namespace Decent
+{
+	namespace Bench
+	{
+		/**
+		 * \brief	Runs microbenchmarks and collects their results in a stable JSON format, so that runs
+		 * 			can be compared by tools. A benchmark is run for one warm-up sample, and then for a
+		 * 			number of samples, each doing a fixed number of operations; the statistics are of the
+		 * 			time per operation over the samples.
+		 */
+		class BenchSuite
+		{
+		public:
+			typedef std::chrono::steady_clock Clock;
+
+			/** \brief	Does the given number of operations. It may throw to report a failure. */
+			typedef std::function<void(uint64_t)> Body;
+
+			/** \brief	Version of the output format; it changes only if existing fields change. */
+			static constexpr unsigned int sk_formatVersion = 1;
+
+		public:
+			/**
+			 * \brief	Constructor
+			 *
+			 * \param	samples 	Number of measured samples per benchmark.
+			 * \param	opsScale	Scale of the number of operations per sample.
+			 * \param	filter  	Only benchmarks whose names contain it are run; empty to run all.
+			 */
+			BenchSuite(size_t samples, double opsScale, const std::string& filter);
+
+			virtual ~BenchSuite();
+
+			/**
+			 * \brief	Runs a benchmark, unless it's filtered out. A failure is recorded in its result.
+			 *
+			 * \param	name		 	The name, in "Group.Name" form.
+			 * \param	opsPerSample 	Number of operations per sample, before scaling.
+			 * \param	body		 	The body.
+			 * \param	info		 	Extra information added to the result (e.g. the parameters).
+			 */
+			void Run(const std::string& name, uint64_t opsPerSample, Body body, const Json::Value& info = Json::Value());
+
+			/**
+			 * \brief	Query if a benchmark would be run, e.g. to skip its preparation.
+			 *
+			 * \param	name	The name.
+			 *
+			 * \return	True if it's selected.
+			 */
+			bool IsSelected(const std::string& name) const;
+
+			/** \brief	Query if any benchmark has failed. */
+			bool HasFailed() const { return m_failedCnt > 0; }
+
+			/**
+			 * \brief	Gets the results, as
+			 * 			{"FormatVersion" : 1, "Samples" : N, "Results" : [{"Name" : ..., "Unit" : "ns",
+			 * 			"OpsPerSample" : N, "Mean" : ..., "Min" : ..., "Median" : ..., "Max" : ...,
+			 * 			"StdDev" : ...}, ...]}. Failed benchmarks have an "Error" instead of statistics.
+			 * 			Results are in the order they were run.
+			 *
+			 * \return	The results.
+			 */
+			Json::Value ToJson() const;
+
+		private:
+			const size_t m_samples;
+			const double m_opsScale;
+			const std::string m_filter;
+
+			std::vector<Json::Value> m_results;
+			size_t m_failedCnt;
+		};
+	}
+}
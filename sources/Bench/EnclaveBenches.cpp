@@ -0,0 +1,96 @@
+#include "EnclaveBenches.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "../IasSim/IasRespSamples.h"
+
+#include "Enclave_u.h"
+#include "BenchSuite.h"
+
+using namespace Decent;
+using namespace Decent::Bench;
+
+namespace
+{
+	static void CheckEcall(sgx_status_t status, int retVal, const char* name)
+	{
+		if (status != SGX_SUCCESS || retVal == 0)
+		{
+			throw std::runtime_error(std::string(name) + " failed (the enclave must be built with DECENT_SERVER_ENCLAVE_BENCH).");
+		}
+	}
+
+	static void IssueCerts(sgx_enclave_id_t enclaveId, uint64_t count, uint64_t batch, bool isFreshKey)
+	{
+		for (uint64_t done = 0; done < count; done += batch)
+		{
+			int retVal = 0;
+			uint64_t certSize = 0;
+			CheckEcall(ecall_decent_server_bench_cert_sign(enclaveId, &retVal, std::min(batch, count - done), isFreshKey ? 1 : 0, &certSize),
+				retVal, "Certificate signing ECALL");
+		}
+	}
+
+	static bool VerifyReports(sgx_enclave_id_t enclaveId, uint64_t count)
+	{
+		int retVal = 0;
+		int isValid = 0;
+		CheckEcall(ecall_decent_server_bench_verify_report(enclaveId, &retVal, count,
+			IasSim::gsk_report, IasSim::gsk_signature, IasSim::gsk_cert, &isValid), retVal, "Report verification ECALL");
+		return isValid != 0;
+	}
+}
+
+void Bench::RunEnclaveBenches(BenchSuite & suite, sgx_enclave_id_t enclaveId, uint64_t certBatch)
+{
+	certBatch = std::max<uint64_t>(certBatch, 1);
+
+	suite.Run("Enclave.EcallRoundTrip", 10000, [enclaveId](uint64_t ops)
+	{
+		for (uint64_t i = 0; i < ops; ++i)
+		{
+			int retVal = 0;
+			CheckEcall(ecall_decent_server_bench_nop(enclaveId, &retVal), retVal, "Empty ECALL");
+		}
+	});
+
+	//One ECALL makes all the OCALLs, so its cost is spread over them.
+	suite.Run("Enclave.OcallRoundTrip", 10000, [enclaveId](uint64_t ops)
+	{
+		int retVal = 0;
+		CheckEcall(ecall_decent_server_bench_ocall(enclaveId, &retVal, ops), retVal, "OCALL ECALL");
+	});
+
+	if (suite.IsSelected("Enclave.ReportVerify"))
+	{
+		Json::Value info;
+		try
+		{
+			//The sample is a real report; if it doesn't verify, the cost of the failure path is measured.
+			info["Valid"] = VerifyReports(enclaveId, 1);
+		}
+		catch (const std::exception&)
+		{}
+		suite.Run("Enclave.ReportVerify", 100, [enclaveId](uint64_t ops)
+		{
+			VerifyReports(enclaveId, ops);
+		}, info);
+	}
+
+	Json::Value batchInfo;
+	batchInfo["Batch"] = static_cast<Json::UInt64>(certBatch);
+
+	suite.Run("Enclave.CertSign.FreshKey", 50, [enclaveId](uint64_t ops)
+	{
+		IssueCerts(enclaveId, ops, 1, true);
+	});
+	suite.Run("Enclave.CertSign.KeptKey", 50, [enclaveId](uint64_t ops)
+	{
+		IssueCerts(enclaveId, ops, 1, false);
+	});
+	suite.Run("Enclave.CertSign.KeptKeyBatched", 50, [enclaveId, certBatch](uint64_t ops)
+	{
+		IssueCerts(enclaveId, ops, certBatch, false);
+	}, batchInfo);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+#include <sgx_urts.h>
+
+namespace Decent
+{
+	namespace Bench
+	{
+		class BenchSuite;
+
+		/**
+		 * \brief	Runs the benchmarks of the enclave hot paths: ECALL and OCALL round trips, IAS report
+		 * 			verification, and certificate issuing. The enclave must be built with the
+		 * 			DECENT_SERVER_ENCLAVE_BENCH option, otherwise they are recorded as failed.
+		 *
+		 * \param [in,out]	suite	 	The suite.
+		 * \param 		  	enclaveId	The enclave ID.
+		 * \param 		  	certBatch	Number of certificates issued per ECALL in the batched run.
+		 */
+		void RunEnclaveBenches(BenchSuite& suite, sgx_enclave_id_t enclaveId, uint64_t certBatch);
+	}
+}
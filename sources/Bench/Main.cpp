@@ -0,0 +1,122 @@
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#include <tclap/CmdLine.h>
+#include <json/json.h>
+
+#include <sgx_urts.h>
+
+#include <DecentApi/Common/Common.h>
+
+#include "BenchSuite.h"
+#include "EnclaveBenches.h"
+#include "AppBenches.h"
+
+#define DECENT_SERVER_BENCH_VERSION_MAIN 0
+#define DECENT_SERVER_BENCH_VERSION_SUB  2
+
+#define QUOTE(str) #str
+#define EXPAND_AND_QUOTE(str) QUOTE(str)
+#define DECENT_SERVER_BENCH_VERSION_STR EXPAND_AND_QUOTE(DECENT_SERVER_BENCH_VERSION_MAIN) "." EXPAND_AND_QUOTE(DECENT_SERVER_BENCH_VERSION_SUB)
+#define DECENT_SERVER_BENCH_VERSION_STR_W_PREFIX "Ver" DECENT_SERVER_BENCH_VERSION_STR
+
+using namespace Decent;
+using namespace Decent::Bench;
+
+namespace
+{
+	static Json::Value GetBuildInfo()
+	{
+		Json::Value build;
+#ifdef SIMULATING_ENCLAVE
+		build["Simulation"] = true;
+#else
+		build["Simulation"] = false;
+#endif
+#ifdef DEBUG
+		build["Debug"] = true;
+#else
+		build["Debug"] = false;
+#endif
+		return build;
+	}
+}
+
+/**
+ * \brief	Main entry-point for this application
+ *
+ * \param	argc	The number of command-line arguments provided.
+ * \param	argv	An array of command-line argument strings.
+ *
+ * \return	Exit-code for the process - 0 for success, else an error code.
+ */
+int main(int argc, char ** argv)
+{
+	//The results may go to stdout, so the banner goes to stderr.
+	std::cerr << "================ Decent Server Benchmarks " DECENT_SERVER_BENCH_VERSION_STR_W_PREFIX " ================" << std::endl;
+
+	TCLAP::CmdLine cmd("Decent Server Benchmarks", ' ', DECENT_SERVER_BENCH_VERSION_STR_W_PREFIX, true);
+
+	TCLAP::ValueArg<std::string> enclaveArg("e", "enclave", "Path to the signed enclave.", false, ENCLAVE_FILENAME, "String");
+	TCLAP::ValueArg<std::string> configArg("c", "config", "Path to the configuration file parsed by Config.Parse.", false, "Config.json", "String");
+	TCLAP::ValueArg<std::string> outputArg("o", "output", "Path to the JSON results; stdout if not given.", false, "", "String");
+	TCLAP::ValueArg<std::string> filterArg("f", "filter", "Only run benchmarks whose names contain this string.", false, "", "String");
+	TCLAP::ValueArg<uint64_t> samplesArg("s", "samples", "Number of measured samples per benchmark.", false, 10, "Integer");
+	TCLAP::ValueArg<double> opsScaleArg("x", "ops-scale", "Scales the number of operations per sample.", false, 1.0, "Float");
+	TCLAP::ValueArg<uint16_t> portArg("p", "port", "Port of the loopback connection.", false, 57799, "Integer");
+	TCLAP::ValueArg<uint64_t> certBatchArg("b", "cert-batch", "Number of certificates issued per ECALL in the batched run.", false, 16, "Integer");
+	cmd.add(enclaveArg);
+	cmd.add(configArg);
+	cmd.add(outputArg);
+	cmd.add(filterArg);
+	cmd.add(samplesArg);
+	cmd.add(opsScaleArg);
+	cmd.add(portArg);
+	cmd.add(certBatchArg);
+
+	cmd.parse(argc, argv);
+
+	sgx_enclave_id_t enclaveId = 0;
+	sgx_launch_token_t token = { 0 };
+	int isTokenUpdated = 0;
+	if (sgx_create_enclave(enclaveArg.getValue().c_str(), SGX_DEBUG_FLAG, &token, &isTokenUpdated, &enclaveId, nullptr) != SGX_SUCCESS)
+	{
+		PRINT_W("Failed to create enclave from %s.", enclaveArg.getValue().c_str());
+		return -1;
+	}
+
+	BenchSuite suite(std::max<uint64_t>(samplesArg.getValue(), 1), opsScaleArg.getValue(), filterArg.getValue());
+
+	RunEnclaveBenches(suite, enclaveId, std::max<uint64_t>(certBatchArg.getValue(), 1));
+	RunAppBenches(suite, configArg.getValue(), portArg.getValue());
+
+	sgx_destroy_enclave(enclaveId);
+
+	Json::Value root = suite.ToJson();
+	root["Tool"] = "DecentServerBench";
+	root["Version"] = DECENT_SERVER_BENCH_VERSION_STR;
+	root["Build"] = GetBuildInfo();
+
+	Json::StreamWriterBuilder writerBuilder;
+	writerBuilder["indentation"] = "\t";
+	const std::string resultStr = Json::writeString(writerBuilder, root);
+
+	if (outputArg.getValue().empty())
+	{
+		std::cout << resultStr << std::endl;
+	}
+	else
+	{
+		std::ofstream outFile(outputArg.getValue(), std::ios::trunc);
+		outFile << resultStr << std::endl;
+		if (!outFile)
+		{
+			PRINT_W("Failed to write the results to %s.", outputArg.getValue().c_str());
+			return -1;
+		}
+	}
+
+	return suite.HasFailed() ? -1 : 0;
+}
@@ -0,0 +1,172 @@
+#include "LatencyHistogram.h"
+
+#include <limits>
+#include <algorithm>
+
+using namespace Decent;
+using namespace Decent::Perf;
+
+namespace
+{
+	static uint32_t GetMsbIndex(uint64_t value) noexcept
+	{
+		uint32_t res = 0;
+		while (value >>= 1)
+		{
+			++res;
+		}
+		return res;
+	}
+
+	static void AtomicStoreMin(std::atomic<uint64_t>& dest, uint64_t value) noexcept
+	{
+		uint64_t cur = dest.load(std::memory_order_relaxed);
+		while (value < cur && !dest.compare_exchange_weak(cur, value, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	static void AtomicStoreMax(std::atomic<uint64_t>& dest, uint64_t value) noexcept
+	{
+		uint64_t cur = dest.load(std::memory_order_relaxed);
+		while (value > cur && !dest.compare_exchange_weak(cur, value, std::memory_order_relaxed))
+		{
+		}
+	}
+}
+
+constexpr uint32_t LatencyHistogram::sk_subBucketBits;
+constexpr uint64_t LatencyHistogram::sk_subBucketNum;
+constexpr uint64_t LatencyHistogram::sk_subBucketHalf;
+constexpr size_t LatencyHistogram::sk_bucketNum;
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value) noexcept
+{
+	if (value < sk_subBucketNum)
+	{
+		return static_cast<size_t>(value);
+	}
+
+	//value >> shift is in [sk_subBucketHalf, sk_subBucketNum).
+	const uint32_t shift = GetMsbIndex(value) - (sk_subBucketBits - 1);
+	return static_cast<size_t>(sk_subBucketNum + (shift - 1) * sk_subBucketHalf + ((value >> shift) - sk_subBucketHalf));
+}
+
+uint64_t LatencyHistogram::GetBucketHighest(size_t index) noexcept
+{
+	if (index < sk_subBucketNum)
+	{
+		return index;
+	}
+
+	const uint64_t shift = ((index - sk_subBucketNum) / sk_subBucketHalf) + 1;
+	const uint64_t sub = ((index - sk_subBucketNum) % sk_subBucketHalf) + sk_subBucketHalf;
+	const uint64_t lowest = sub << shift;
+	return lowest + ((1ULL << shift) - 1);
+}
+
+LatencyHistogram::LatencyHistogram() :
+	m_count(0),
+	m_sum(0),
+	m_min(std::numeric_limits<uint64_t>::max()),
+	m_max(0)
+{
+	for (auto& bucket : m_buckets)
+	{
+		bucket.store(0, std::memory_order_relaxed);
+	}
+}
+
+LatencyHistogram::~LatencyHistogram()
+{
+}
+
+void LatencyHistogram::Record(uint64_t value) noexcept
+{
+	m_buckets[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+	m_count.fetch_add(1, std::memory_order_relaxed);
+	m_sum.fetch_add(value, std::memory_order_relaxed);
+	AtomicStoreMin(m_min, value);
+	AtomicStoreMax(m_max, value);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram & other) noexcept
+{
+	for (size_t i = 0; i < sk_bucketNum; ++i)
+	{
+		const uint64_t count = other.m_buckets[i].load(std::memory_order_relaxed);
+		if (count > 0)
+		{
+			m_buckets[i].fetch_add(count, std::memory_order_relaxed);
+		}
+	}
+	m_count.fetch_add(other.m_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	m_sum.fetch_add(other.m_sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	AtomicStoreMin(m_min, other.m_min.load(std::memory_order_relaxed));
+	AtomicStoreMax(m_max, other.m_max.load(std::memory_order_relaxed));
+}
+
+void LatencyHistogram::Reset() noexcept
+{
+	for (auto& bucket : m_buckets)
+	{
+		bucket.store(0, std::memory_order_relaxed);
+	}
+	m_count.store(0, std::memory_order_relaxed);
+	m_sum.store(0, std::memory_order_relaxed);
+	m_min.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+	m_max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetMin() const noexcept
+{
+	return GetCount() == 0 ? 0 : m_min.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::GetMean() const noexcept
+{
+	const uint64_t count = GetCount();
+	return count == 0 ? 0.0 : static_cast<double>(GetSum()) / count;
+}
+
+uint64_t LatencyHistogram::GetPercentile(double percentile) const noexcept
+{
+	//Count the buckets, instead of using m_count, so that the result is consistent with what is scanned.
+	uint64_t total = 0;
+	for (const auto& bucket : m_buckets)
+	{
+		total += bucket.load(std::memory_order_relaxed);
+	}
+	if (total == 0)
+	{
+		return 0;
+	}
+
+	percentile = std::min(std::max(percentile, 0.0), 100.0);
+	const uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>((percentile / 100.0) * total + 0.5), 1);
+
+	uint64_t seen = 0;
+	for (size_t i = 0; i < sk_bucketNum; ++i)
+	{
+		seen += m_buckets[i].load(std::memory_order_relaxed);
+		if (seen >= rank)
+		{
+			return std::min(GetBucketHighest(i), GetMax());
+		}
+	}
+	return GetMax();
+}
+
+std::vector<std::pair<uint64_t, uint64_t> > LatencyHistogram::GetBuckets() const
+{
+	std::vector<std::pair<uint64_t, uint64_t> > res;
+	for (size_t i = 0; i < sk_bucketNum; ++i)
+	{
+		const uint64_t count = m_buckets[i].load(std::memory_order_relaxed);
+		if (count > 0)
+		{
+			res.emplace_back(GetBucketHighest(i), count);
+		}
+	}
+	return res;
+}
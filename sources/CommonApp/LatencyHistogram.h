@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+namespace Decent
+{
+	namespace Perf
+	{
+		/**
+		 * \brief	A log-linear (HDR style) histogram of latencies in microseconds. Every power-of-two
+		 * 			range is split into 64 sub-buckets, so values are kept with about 1.6% precision, up
+		 * 			to the full range of uint64_t. Recording is lock-free and wait-free, so it can stay
+		 * 			on in the hot path; reading while recording gives an approximate snapshot.
+		 */
+		class LatencyHistogram
+		{
+		public:
+			static constexpr uint32_t sk_subBucketBits = 7;
+			static constexpr uint64_t sk_subBucketNum = 1ULL << sk_subBucketBits;
+			static constexpr uint64_t sk_subBucketHalf = sk_subBucketNum / 2;
+			static constexpr size_t sk_bucketNum = static_cast<size_t>(sk_subBucketNum + (64 - sk_subBucketBits) * sk_subBucketHalf);
+
+		public:
+			LatencyHistogram();
+
+			virtual ~LatencyHistogram();
+
+			/**
+			 * \brief	Records a value.
+			 *
+			 * \param	value	The value, in microseconds.
+			 */
+			void Record(uint64_t value) noexcept;
+
+			/**
+			 * \brief	Adds all values recorded in another histogram into this one.
+			 *
+			 * \param	other	The other histogram.
+			 */
+			void Merge(const LatencyHistogram& other) noexcept;
+
+			/** \brief	Clears all recorded values. Values recorded concurrently may be partially kept. */
+			void Reset() noexcept;
+
+			uint64_t GetCount() const noexcept { return m_count.load(std::memory_order_relaxed); }
+
+			uint64_t GetSum() const noexcept { return m_sum.load(std::memory_order_relaxed); }
+
+			uint64_t GetMin() const noexcept;
+
+			uint64_t GetMax() const noexcept { return m_max.load(std::memory_order_relaxed); }
+
+			double GetMean() const noexcept;
+
+			/**
+			 * \brief	Gets the value at a given percentile, i.e., the highest value that is equivalent
+			 * 			(within the histogram's precision) to the recorded value at that rank.
+			 *
+			 * \param	percentile	The percentile, in [0, 100].
+			 *
+			 * \return	The value, in microseconds; 0 if nothing has been recorded.
+			 */
+			uint64_t GetPercentile(double percentile) const noexcept;
+
+			/**
+			 * \brief	Gets all non-empty buckets.
+			 *
+			 * \return	Pairs of (highest equivalent value, count), in ascending order.
+			 */
+			std::vector<std::pair<uint64_t, uint64_t> > GetBuckets() const;
+
+			static size_t GetBucketIndex(uint64_t value) noexcept;
+
+			static uint64_t GetBucketHighest(size_t index) noexcept;
+
+		private:
+			std::array<std::atomic<uint64_t>, sk_bucketNum> m_buckets;
+			std::atomic<uint64_t> m_count;
+			std::atomic<uint64_t> m_sum;
+			std::atomic<uint64_t> m_min;
+			std::atomic<uint64_t> m_max;
+		};
+	}
+}
@@ -0,0 +1,612 @@
+#include "ShmRingConnection.h"
+
+#include <new>
+#include <atomic>
+#include <cstring>
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+
+#include <DecentApi/CommonApp/Net/LocalConnection.h>
+
+#ifdef __linux__
+#	include <poll.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/un.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <sys/socket.h>
+#	include <sys/syscall.h>
+#	include <linux/futex.h>
+#endif // __linux__
+
+using namespace Decent;
+using namespace Decent::ShmNet;
+
+constexpr uint32_t ShmRingConnection::sk_version;
+constexpr size_t ShmRingConnection::sk_minRingSize;
+constexpr size_t ShmRingConnection::sk_maxRingSize;
+
+namespace Decent
+{
+	namespace ShmNet
+	{
+		/**
+		 * \brief	Control block of one ring. The producer only writes the tail and the consumer only
+		 * 			writes the head; they are on different cache lines, so neither side's writes evict
+		 * 			the other's.
+		 */
+		struct RingControl
+		{
+			alignas(64) std::atomic<uint64_t> m_head;
+			alignas(64) std::atomic<uint64_t> m_tail;
+
+			//Futex words, bumped when data is added or space is freed, and the number of their waiters.
+			alignas(64) std::atomic<uint32_t> m_dataSeq;
+			std::atomic<uint32_t> m_dataWaiters;
+			alignas(64) std::atomic<uint32_t> m_spaceSeq;
+			std::atomic<uint32_t> m_spaceWaiters;
+		};
+
+		/** \brief	The start of the shared-memory segment; the data of both rings follows it. */
+		struct SharedHeader
+		{
+			uint32_t m_magic;
+			uint32_t m_version;
+			uint64_t m_ringSize;
+
+			//Flags of the sides that have closed the connection.
+			alignas(64) std::atomic<uint32_t> m_closed;
+
+			//Ring 0 goes from the client to the server, and ring 1 the other way.
+			RingControl m_rings[2];
+		};
+	}
+}
+
+namespace
+{
+	static constexpr uint32_t gsk_magic = 0x52534344; //"DCSR"
+
+	static constexpr uint32_t gsk_serverClosed = 1;
+	static constexpr uint32_t gsk_clientClosed = 2;
+
+	static constexpr size_t gsk_pageSize = 4096;
+	static constexpr size_t gsk_dataOffset = ((sizeof(SharedHeader) + gsk_pageSize - 1) / gsk_pageSize) * gsk_pageSize;
+
+	static size_t GetMapSize(size_t ringSize)
+	{
+		return gsk_dataOffset + 2 * ringSize;
+	}
+
+	static bool IsValidRingSize(uint64_t ringSize)
+	{
+		return ringSize >= ShmRingConnection::sk_minRingSize && ringSize <= ShmRingConnection::sk_maxRingSize &&
+			(ringSize & (ringSize - 1)) == 0;
+	}
+
+	/** \brief	The message of the handshake; the server's reply also carries the segment's file. */
+	struct HandshakeMsg
+	{
+		uint32_t m_magic;
+		uint32_t m_version;
+		uint64_t m_ringSize;
+	};
+}
+
+#ifdef __linux__
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Futex words must be plain 32-bit integers.");
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2, "Atomics shared between processes must be lock-free.");
+
+namespace
+{
+	//Spinning covers the case where the peer answers within a few microseconds, without a syscall.
+	static constexpr int gsk_spinCount = 256;
+
+	//How often a sleeping side checks if the peer process is still there.
+	static constexpr long gsk_peerCheckIntervalMs = 100;
+
+	static constexpr int gsk_handshakeTimeoutSec = 2;
+
+	static void CpuRelax() noexcept
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#endif
+	}
+
+	static void FutexWait(std::atomic<uint32_t>& word, uint32_t value, long timeoutMs) noexcept
+	{
+		timespec timeout = {};
+		timeout.tv_sec = timeoutMs / 1000;
+		timeout.tv_nsec = (timeoutMs % 1000) * 1000000;
+		//The segment is shared between processes, so the futex can't be a private one.
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, value, &timeout, nullptr, 0);
+	}
+
+	static void FutexWakeAll(std::atomic<uint32_t>& word) noexcept
+	{
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+	}
+
+	static void Signal(std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiters) noexcept
+	{
+		//Pairs with the waiter registering itself before checking the ring again.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (waiters.load(std::memory_order_seq_cst) > 0)
+		{
+			seq.fetch_add(1, std::memory_order_seq_cst);
+			FutexWakeAll(seq);
+		}
+	}
+
+	static void WakeAll(SharedHeader& header) noexcept
+	{
+		for (RingControl& ring : header.m_rings)
+		{
+			ring.m_dataSeq.fetch_add(1, std::memory_order_seq_cst);
+			ring.m_spaceSeq.fetch_add(1, std::memory_order_seq_cst);
+			FutexWakeAll(ring.m_dataSeq);
+			FutexWakeAll(ring.m_spaceSeq);
+		}
+	}
+
+	static bool IsPeerGone(int socket) noexcept
+	{
+		pollfd pollFd = {};
+		pollFd.fd = socket;
+		pollFd.events = POLLRDHUP;
+		return poll(&pollFd, 1, 0) != 0 && (pollFd.revents & (POLLRDHUP | POLLHUP | POLLERR | POLLNVAL)) != 0;
+	}
+
+	static sockaddr_un GetSockAddr(const std::string& address, socklen_t& addrLen)
+	{
+		sockaddr_un addr = {};
+		addr.sun_family = AF_UNIX;
+		if (address.size() > sizeof(addr.sun_path))
+		{
+			throw std::runtime_error("The shared-memory server name is too long.");
+		}
+		std::memcpy(addr.sun_path, address.data(), address.size());
+		addrLen = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + address.size());
+		return addr;
+	}
+
+	static void SetHandshakeTimeout(int socket)
+	{
+		timeval timeout = {};
+		timeout.tv_sec = gsk_handshakeTimeoutSec;
+		if (setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0 ||
+			setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) != 0)
+		{
+			throw std::runtime_error("Failed to set the handshake timeout of the shared-memory connection.");
+		}
+	}
+
+	static void SendHandshake(int socket, const HandshakeMsg& msg, int fileToPass)
+	{
+		iovec iov = {};
+		iov.iov_base = const_cast<HandshakeMsg*>(&msg);
+		iov.iov_len = sizeof(msg);
+
+		alignas(cmsghdr) char ctrlBuf[CMSG_SPACE(sizeof(int))] = {};
+		msghdr header = {};
+		header.msg_iov = &iov;
+		header.msg_iovlen = 1;
+		if (fileToPass >= 0)
+		{
+			header.msg_control = ctrlBuf;
+			header.msg_controllen = sizeof(ctrlBuf);
+			cmsghdr* ctrl = CMSG_FIRSTHDR(&header);
+			ctrl->cmsg_level = SOL_SOCKET;
+			ctrl->cmsg_type = SCM_RIGHTS;
+			ctrl->cmsg_len = CMSG_LEN(sizeof(int));
+			std::memcpy(CMSG_DATA(ctrl), &fileToPass, sizeof(int));
+		}
+
+		if (sendmsg(socket, &header, MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(msg)))
+		{
+			throw std::runtime_error("Failed to send the shared-memory handshake.");
+		}
+	}
+
+	/**
+	 * \brief	Receives a handshake message.
+	 *
+	 * \exception	std::runtime_error	Thrown if it fails, or the message is not a valid one.
+	 *
+	 * \param 		  	socket		  	The socket.
+	 * \param [out]		passedFile	  	The file passed along, or -1 if there is none.
+	 *
+	 * \return	The message.
+	 */
+	static HandshakeMsg RecvHandshake(int socket, int& passedFile)
+	{
+		HandshakeMsg msg = {};
+		iovec iov = {};
+		iov.iov_base = &msg;
+		iov.iov_len = sizeof(msg);
+
+		alignas(cmsghdr) char ctrlBuf[CMSG_SPACE(sizeof(int))] = {};
+		msghdr header = {};
+		header.msg_iov = &iov;
+		header.msg_iovlen = 1;
+		header.msg_control = ctrlBuf;
+		header.msg_controllen = sizeof(ctrlBuf);
+
+		passedFile = -1;
+		const ssize_t recvSize = recvmsg(socket, &header, MSG_CMSG_CLOEXEC);
+		for (cmsghdr* ctrl = CMSG_FIRSTHDR(&header); recvSize >= 0 && ctrl != nullptr; ctrl = CMSG_NXTHDR(&header, ctrl))
+		{
+			if (ctrl->cmsg_level == SOL_SOCKET && ctrl->cmsg_type == SCM_RIGHTS && ctrl->cmsg_len == CMSG_LEN(sizeof(int)))
+			{
+				std::memcpy(&passedFile, CMSG_DATA(ctrl), sizeof(int));
+			}
+		}
+
+		if (recvSize != static_cast<ssize_t>(sizeof(msg)) || (header.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) != 0 ||
+			msg.m_magic != gsk_magic || msg.m_version != ShmRingConnection::sk_version)
+		{
+			if (passedFile >= 0)
+			{
+				close(passedFile);
+				passedFile = -1;
+			}
+			throw std::runtime_error("Invalid shared-memory handshake.");
+		}
+		return msg;
+	}
+
+	/** \brief	Closes a file when it goes out of scope, unless it's released. */
+	class FileGuard
+	{
+	public:
+		FileGuard(int file) noexcept :
+			m_file(file)
+		{}
+
+		~FileGuard()
+		{
+			if (m_file >= 0)
+			{
+				close(m_file);
+			}
+		}
+
+		int Get() const noexcept { return m_file; }
+
+		int Release() noexcept
+		{
+			const int file = m_file;
+			m_file = -1;
+			return file;
+		}
+
+	private:
+		int m_file;
+	};
+}
+
+std::unique_ptr<ShmRingConnection> ShmRingConnection::Connect(const std::string & serverName)
+{
+	FileGuard socketGuard(socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0));
+	if (socketGuard.Get() < 0)
+	{
+		throw std::runtime_error("Failed to create the socket of the shared-memory connection.");
+	}
+
+	socklen_t addrLen = 0;
+	const sockaddr_un addr = GetSockAddr(GetSocketAddress(serverName), addrLen);
+	if (connect(socketGuard.Get(), reinterpret_cast<const sockaddr*>(&addr), addrLen) != 0)
+	{
+		throw std::runtime_error("There is no shared-memory server named " + serverName + " on this host.");
+	}
+	SetHandshakeTimeout(socketGuard.Get());
+
+	SendHandshake(socketGuard.Get(), HandshakeMsg{ gsk_magic, sk_version, 0 }, -1);
+
+	int segmentFile = -1;
+	const HandshakeMsg reply = RecvHandshake(socketGuard.Get(), segmentFile);
+	FileGuard segmentGuard(segmentFile);
+
+	struct stat segmentStat = {};
+	if (segmentGuard.Get() < 0 || !IsValidRingSize(reply.m_ringSize) ||
+		fstat(segmentGuard.Get(), &segmentStat) != 0 || static_cast<uint64_t>(segmentStat.st_size) != GetMapSize(reply.m_ringSize))
+	{
+		throw std::runtime_error("Invalid shared-memory segment from the server.");
+	}
+
+	const size_t mapSize = GetMapSize(static_cast<size_t>(reply.m_ringSize));
+	void* mapping = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, segmentGuard.Get(), 0);
+	if (mapping == MAP_FAILED)
+	{
+		throw std::runtime_error("Failed to map the shared-memory segment.");
+	}
+
+	const SharedHeader& header = *static_cast<const SharedHeader*>(mapping);
+	if (header.m_magic != gsk_magic || header.m_version != sk_version || header.m_ringSize != reply.m_ringSize)
+	{
+		munmap(mapping, mapSize);
+		throw std::runtime_error("Invalid shared-memory segment from the server.");
+	}
+
+	return std::unique_ptr<ShmRingConnection>(new ShmRingConnection(socketGuard.Release(), mapping, mapSize, false));
+}
+
+std::unique_ptr<ShmRingConnection> ShmRingConnection::Accept(int socket, size_t ringSize)
+{
+	FileGuard socketGuard(socket);
+	if (!IsValidRingSize(ringSize))
+	{
+		throw std::runtime_error("Invalid ring size of the shared-memory connection.");
+	}
+	SetHandshakeTimeout(socketGuard.Get());
+
+	int unusedFile = -1;
+	RecvHandshake(socketGuard.Get(), unusedFile);
+	FileGuard unusedGuard(unusedFile);
+
+	const size_t mapSize = GetMapSize(ringSize);
+	FileGuard segmentGuard(static_cast<int>(syscall(SYS_memfd_create, "DecentShmRing", MFD_CLOEXEC)));
+	if (segmentGuard.Get() < 0 || ftruncate(segmentGuard.Get(), static_cast<off_t>(mapSize)) != 0)
+	{
+		throw std::runtime_error("Failed to create the shared-memory segment.");
+	}
+
+	void* mapping = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, segmentGuard.Get(), 0);
+	if (mapping == MAP_FAILED)
+	{
+		throw std::runtime_error("Failed to map the shared-memory segment.");
+	}
+
+	//The file is zero-filled, so only the fixed fields need to be set.
+	SharedHeader* header = new (mapping) SharedHeader();
+	header->m_magic = gsk_magic;
+	header->m_version = sk_version;
+	header->m_ringSize = ringSize;
+
+	std::unique_ptr<ShmRingConnection> connection(new ShmRingConnection(socketGuard.Release(), mapping, mapSize, true));
+
+	//The mapping keeps the segment alive once the client has mapped it too.
+	SendHandshake(connection->m_socket, HandshakeMsg{ gsk_magic, sk_version, ringSize }, segmentGuard.Get());
+
+	timeval noTimeout = {};
+	setsockopt(connection->m_socket, SOL_SOCKET, SO_RCVTIMEO, &noTimeout, sizeof(noTimeout));
+	setsockopt(connection->m_socket, SOL_SOCKET, SO_SNDTIMEO, &noTimeout, sizeof(noTimeout));
+
+	return connection;
+}
+
+ShmRingConnection::ShmRingConnection(int socket, void * mapping, size_t mapSize, bool isServerSide) :
+	m_header(*static_cast<SharedHeader*>(mapping)),
+	m_mapSize(mapSize),
+	m_ringSize(static_cast<size_t>(m_header.m_ringSize)),
+	m_outData(static_cast<uint8_t*>(mapping) + gsk_dataOffset + (isServerSide ? m_ringSize : 0)),
+	m_inData(static_cast<uint8_t*>(mapping) + gsk_dataOffset + (isServerSide ? 0 : m_ringSize)),
+	m_outRing(isServerSide ? 1 : 0),
+	m_inRing(isServerSide ? 0 : 1),
+	m_selfClosedFlag(isServerSide ? gsk_serverClosed : gsk_clientClosed),
+	m_socket(socket),
+	m_outTail(0),
+	m_inHead(0)
+{
+}
+
+ShmRingConnection::~ShmRingConnection()
+{
+	Terminate();
+	munmap(&m_header, m_mapSize);
+	close(m_socket);
+}
+
+size_t ShmRingConnection::SendRaw(const void * const dataPtr, const size_t size)
+{
+	if (size == 0)
+	{
+		return 0;
+	}
+
+	RingControl& ring = m_header.m_rings[m_outRing];
+	const uint64_t tail = m_outTail;
+	uint64_t head = 0;
+
+	//Stops waiting on a head that isn't within one ring behind the tail, too; it never frees space.
+	WaitFor(ring.m_spaceSeq, ring.m_spaceWaiters, [this, &ring, &head, tail]()
+	{
+		head = ring.m_head.load(std::memory_order_acquire);
+		return tail - head != m_ringSize;
+	});
+	if (tail - head > m_ringSize)
+	{
+		ThrowProtocolError();
+	}
+
+	const size_t sendSize = std::min<size_t>(size, static_cast<size_t>(m_ringSize - (tail - head)));
+	const size_t offset = static_cast<size_t>(tail & (m_ringSize - 1));
+	const size_t firstPart = std::min(sendSize, m_ringSize - offset);
+	std::memcpy(m_outData + offset, dataPtr, firstPart);
+	std::memcpy(m_outData, static_cast<const uint8_t*>(dataPtr) + firstPart, sendSize - firstPart);
+
+	m_outTail = tail + sendSize;
+	ring.m_tail.store(m_outTail, std::memory_order_release);
+	Signal(ring.m_dataSeq, ring.m_dataWaiters);
+
+	return sendSize;
+}
+
+size_t ShmRingConnection::RecvRaw(void * const bufPtr, const size_t size)
+{
+	if (size == 0)
+	{
+		return 0;
+	}
+
+	RingControl& ring = m_header.m_rings[m_inRing];
+	const uint64_t head = m_inHead;
+	uint64_t tail = head;
+
+	WaitFor(ring.m_dataSeq, ring.m_dataWaiters, [&ring, &tail, head]()
+	{
+		tail = ring.m_tail.load(std::memory_order_acquire);
+		return tail != head;
+	});
+	//More than a ring of data (or a tail behind the head) would have the copy run past the ring.
+	if (tail - head > m_ringSize)
+	{
+		ThrowProtocolError();
+	}
+
+	//At most m_ringSize, as checked above.
+	const size_t recvSize = std::min<size_t>(size, static_cast<size_t>(tail - head));
+	const size_t offset = static_cast<size_t>(head & (m_ringSize - 1));
+	const size_t firstPart = std::min(recvSize, m_ringSize - offset);
+	std::memcpy(bufPtr, m_inData + offset, firstPart);
+	std::memcpy(static_cast<uint8_t*>(bufPtr) + firstPart, m_inData, recvSize - firstPart);
+
+	m_inHead = head + recvSize;
+	ring.m_head.store(m_inHead, std::memory_order_release);
+	Signal(ring.m_spaceSeq, ring.m_spaceWaiters);
+
+	return recvSize;
+}
+
+void ShmRingConnection::Terminate() noexcept
+{
+	if ((m_header.m_closed.fetch_or(m_selfClosedFlag, std::memory_order_seq_cst) & m_selfClosedFlag) == 0)
+	{
+		WakeAll(m_header);
+		shutdown(m_socket, SHUT_RDWR);
+	}
+}
+
+template<typename SeqType, typename PredType>
+void ShmRingConnection::WaitFor(SeqType & seq, SeqType & waiters, PredType isReady)
+{
+	for (int i = 0; i < gsk_spinCount; ++i)
+	{
+		if (isReady())
+		{
+			return;
+		}
+		CpuRelax();
+	}
+
+	while (true)
+	{
+		waiters.fetch_add(1, std::memory_order_seq_cst);
+		const uint32_t seqValue = seq.load(std::memory_order_seq_cst);
+		//Data left in the ring by a peer that has closed is still delivered.
+		if (isReady())
+		{
+			waiters.fetch_sub(1, std::memory_order_seq_cst);
+			return;
+		}
+		if (IsClosed())
+		{
+			waiters.fetch_sub(1, std::memory_order_seq_cst);
+			throw std::runtime_error("The shared-memory connection is closed.");
+		}
+
+		FutexWait(seq, seqValue, gsk_peerCheckIntervalMs);
+		waiters.fetch_sub(1, std::memory_order_seq_cst);
+
+		if (!isReady() && IsPeerGone(m_socket))
+		{
+			throw std::runtime_error("The peer of the shared-memory connection is gone.");
+		}
+	}
+}
+
+bool ShmRingConnection::IsClosed() const noexcept
+{
+	return m_header.m_closed.load(std::memory_order_seq_cst) != 0;
+}
+
+void ShmRingConnection::ThrowProtocolError()
+{
+	Terminate();
+	throw std::runtime_error("The peer of the shared-memory connection has corrupted the ring indices.");
+}
+
+std::string ShmRingConnection::GetSocketAddress(const std::string & serverName)
+{
+	return std::string(1, '\0') + "DecentShm_" + serverName;
+}
+
+std::unique_ptr<Net::ConnectionBase> ShmNet::ConnectLocal(const std::string & serverName)
+{
+	try
+	{
+		return ShmRingConnection::Connect(serverName);
+	}
+	catch (const std::exception&)
+	{
+		//The server doesn't offer shared memory, or it's on another host (or network namespace).
+	}
+	return std::make_unique<Net::LocalConnection>(serverName);
+}
+
+#else
+
+std::unique_ptr<ShmRingConnection> ShmRingConnection::Connect(const std::string & serverName)
+{
+	throw std::runtime_error("Shared-memory connections are only supported on Linux.");
+}
+
+std::unique_ptr<ShmRingConnection> ShmRingConnection::Accept(int socket, size_t ringSize)
+{
+	throw std::runtime_error("Shared-memory connections are only supported on Linux.");
+}
+
+ShmRingConnection::ShmRingConnection(int socket, void * mapping, size_t mapSize, bool isServerSide) :
+	m_header(*static_cast<SharedHeader*>(mapping)),
+	m_mapSize(mapSize),
+	m_ringSize(0),
+	m_outData(nullptr),
+	m_inData(nullptr),
+	m_outRing(0),
+	m_inRing(0),
+	m_selfClosedFlag(0),
+	m_socket(socket),
+	m_outTail(0),
+	m_inHead(0)
+{
+	throw std::runtime_error("Shared-memory connections are only supported on Linux.");
+}
+
+ShmRingConnection::~ShmRingConnection()
+{
+}
+
+size_t ShmRingConnection::SendRaw(const void * const dataPtr, const size_t size)
+{
+	throw std::runtime_error("Shared-memory connections are only supported on Linux.");
+}
+
+size_t ShmRingConnection::RecvRaw(void * const bufPtr, const size_t size)
+{
+	throw std::runtime_error("Shared-memory connections are only supported on Linux.");
+}
+
+void ShmRingConnection::Terminate() noexcept
+{
+}
+
+bool ShmRingConnection::IsClosed() const noexcept
+{
+	return true;
+}
+
+std::string ShmRingConnection::GetSocketAddress(const std::string & serverName)
+{
+	return serverName;
+}
+
+std::unique_ptr<Net::ConnectionBase> ShmNet::ConnectLocal(const std::string & serverName)
+{
+	return std::make_unique<Net::LocalConnection>(serverName);
+}
+
+#endif // __linux__
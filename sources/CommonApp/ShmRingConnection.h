@@ -0,0 +1,150 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#include <DecentApi/Common/Net/ConnectionBase.h>
+
+namespace Decent
+{
+	namespace ShmNet
+	{
+		struct SharedHeader;
+
+		/**
+		 * \brief	A connection between two processes on the same host, over a shared-memory segment
+		 * 			holding one ring buffer for each direction (Linux only). Bytes are copied straight
+		 * 			into the peer's ring, rather than through the kernel's socket buffers, and a blocked
+		 * 			side sleeps on a futex in the segment that the other side wakes.
+		 *
+		 * 			The segment is an anonymous memory file handed over through a Unix domain socket
+		 * 			(in the abstract namespace) at connection time. The socket stays open, only to
+		 * 			tell when the peer process is gone.
+		 */
+		class ShmRingConnection : public Net::ConnectionBase
+		{
+		public:
+			/** \brief	Version of the segment layout and the handshake. */
+			static constexpr uint32_t sk_version = 1;
+
+			/** \brief	Smallest and largest ring sizes accepted; sizes are powers of two. */
+			static constexpr size_t sk_minRingSize = 4 * 1024;
+			static constexpr size_t sk_maxRingSize = 1024 * 1024 * 1024;
+
+		public:
+			/**
+			 * \brief	Connects to a ShmRingServer.
+			 *
+			 * \exception	std::runtime_error	Thrown if there is no such server on this host, or the
+			 * 									handshake fails.
+			 *
+			 * \param	serverName	The name of the server.
+			 *
+			 * \return	The connection.
+			 */
+			static std::unique_ptr<ShmRingConnection> Connect(const std::string& serverName);
+
+			/**
+			 * \brief	Sets up the shared-memory segment for a client that has just connected to the
+			 * 			server's Unix domain socket, and hands it over.
+			 *
+			 * \exception	std::runtime_error	Thrown if the handshake fails.
+			 *
+			 * \param	socket  	The accepted socket; it's owned by the connection, or closed if this
+			 * 						throws.
+			 * \param	ringSize	Size of each ring; a power of two.
+			 *
+			 * \return	The connection.
+			 */
+			static std::unique_ptr<ShmRingConnection> Accept(int socket, size_t ringSize);
+
+			/**
+			 * \brief	Gets the Unix domain socket address used by a ShmRingServer with the given name.
+			 *
+			 * \param	serverName	The name of the server.
+			 *
+			 * \return	The socket address, starting with the null byte of the abstract namespace.
+			 */
+			static std::string GetSocketAddress(const std::string& serverName);
+
+		public:
+			ShmRingConnection(const ShmRingConnection& rhs) = delete;
+
+			virtual ~ShmRingConnection();
+
+			/**
+			 * \brief	Copies as many bytes as fit into the outgoing ring, waiting until at least one does.
+			 *
+			 * \exception	std::runtime_error	Thrown if either side has closed the connection, or the
+			 * 									peer has broken the protocol (the connection is then
+			 * 									closed).
+			 */
+			virtual size_t SendRaw(const void* const dataPtr, const size_t size) override;
+
+			/**
+			 * \brief	Takes as many bytes as are in the incoming ring, waiting until there is at least one.
+			 *
+			 * \exception	std::runtime_error	Thrown if either side has closed the connection (and the
+			 * 									ring is drained), or the peer has broken the protocol
+			 * 									(the connection is then closed).
+			 */
+			virtual size_t RecvRaw(void* const bufPtr, const size_t size) override;
+
+			virtual void Terminate() noexcept override;
+
+		private:
+			ShmRingConnection(int socket, void* mapping, size_t mapSize, bool isServerSide);
+
+			/**
+			 * \brief	Waits until a condition on a ring holds, spinning briefly before sleeping on the
+			 * 			ring's futex.
+			 *
+			 * \exception	std::runtime_error	Thrown if the connection is closed while waiting.
+			 *
+			 * \param	seq	   	The futex word bumped when the condition may have changed.
+			 * \param	waiters	The number of waiters, so the other side knows to wake them.
+			 * \param	isReady	Checks the condition.
+			 */
+			template<typename SeqType, typename PredType>
+			void WaitFor(SeqType& seq, SeqType& waiters, PredType isReady);
+
+			bool IsClosed() const noexcept;
+
+			/**
+			 * \brief	Closes the connection because of what the peer has written to the segment.
+			 *
+			 * \exception	std::runtime_error	Always thrown.
+			 */
+			[[noreturn]] void ThrowProtocolError();
+
+			SharedHeader& m_header;
+			const size_t m_mapSize;
+			const size_t m_ringSize;
+			uint8_t* const m_outData;
+			uint8_t* const m_inData;
+			const size_t m_outRing;
+			const size_t m_inRing;
+			const uint32_t m_selfClosedFlag;
+			int m_socket;
+
+			//Our own copies of the indices only this side moves; the ones in the segment are only
+			//written, since the peer can change them at any time.
+			uint64_t m_outTail;
+			uint64_t m_inHead;
+		};
+
+		/**
+		 * \brief	Connects to a local server on the same host, over shared memory if the server offers
+		 * 			it under the same name, or else through Net::LocalConnection.
+		 *
+		 * \exception	std::runtime_error	Thrown if neither can be connected.
+		 *
+		 * \param	serverName	Name of the local server.
+		 *
+		 * \return	The connection.
+		 */
+		std::unique_ptr<Net::ConnectionBase> ConnectLocal(const std::string& serverName);
+	}
+}
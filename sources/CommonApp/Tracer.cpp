@@ -0,0 +1,398 @@
+#include "Tracer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#	include <process.h>
+#else
+#	include <unistd.h>
+#	include <cerrno>
+#endif // _WIN32
+
+using namespace Decent;
+using namespace Decent::Perf;
+
+constexpr size_t Tracer::sk_defBufferSize;
+
+namespace
+{
+	static std::atomic<uint64_t> gs_nextTraceId(1);
+
+	thread_local uint64_t gt_traceId = 0;
+
+	static uint64_t ToUs(Tracer::Clock::time_point time)
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count());
+	}
+
+	static uint32_t GetProcessId()
+	{
+#ifdef _WIN32
+		return static_cast<uint32_t>(_getpid());
+#else
+		return static_cast<uint32_t>(getpid());
+#endif // _WIN32
+	}
+
+	/**
+	 * \brief	Creates the trace file holding the opening bracket, unless it already exists. The file is
+	 * 			written under a temporary name first and then moved in place without replacing, so among
+	 * 			processes starting on the same file exactly one writes the bracket, and nobody appends
+	 * 			before it.
+	 *
+	 * \param	filePath	Path to the trace file.
+	 * \param	pid			ID of this process, making the temporary name unique.
+	 *
+	 * \return	True if it succeeds or the file already exists, false if it fails.
+	 */
+	static bool CreateTraceFile(const std::string& filePath, uint32_t pid)
+	{
+		const std::string tmpPath = filePath + "." + std::to_string(pid) + ".tmp";
+		std::FILE* tmpFile = std::fopen(tmpPath.c_str(), "wb");
+		if (tmpFile == nullptr)
+		{
+			return false;
+		}
+		//The closing bracket is optional in the JSON array format, so events can keep being appended.
+		static constexpr char sk_header[] = "[\n";
+		const bool isWritten = std::fwrite(sk_header, 1, sizeof(sk_header) - 1, tmpFile) == sizeof(sk_header) - 1;
+		const bool isClosed = std::fclose(tmpFile) == 0;
+		if (!isWritten || !isClosed)
+		{
+			std::remove(tmpPath.c_str());
+			return false;
+		}
+
+#ifdef _WIN32
+		//rename doesn't replace an existing file on Windows.
+		const bool isMoved = std::rename(tmpPath.c_str(), filePath.c_str()) == 0;
+		std::remove(tmpPath.c_str());
+		if (!isMoved)
+		{
+			std::FILE* file = std::fopen(filePath.c_str(), "rb");
+			if (file == nullptr)
+			{
+				return false;
+			}
+			std::fclose(file);
+		}
+		return true;
+#else
+		//link fails instead of replacing an existing file.
+		const bool isLinked = link(tmpPath.c_str(), filePath.c_str()) == 0 || errno == EEXIST;
+		unlink(tmpPath.c_str());
+		return isLinked;
+#endif // _WIN32
+	}
+}
+
+/**
+ * \brief	A single-producer, single-consumer ring of events. The owning thread only moves the write
+ * 			position, and the flushing thread only moves the read position.
+ */
+struct Tracer::ThreadBuffer
+{
+	struct Event
+	{
+		const char* m_name;
+		uint64_t m_startUs;
+		uint64_t m_durUs;
+		uint64_t m_traceId;
+		bool m_isInstant;
+	};
+
+	ThreadBuffer(size_t size, uint32_t tid) :
+		m_events(size),
+		m_tid(tid),
+		m_isNamed(false),
+		m_written(0),
+		m_read(0)
+	{}
+
+	std::vector<Event> m_events;
+	const uint32_t m_tid;
+	bool m_isNamed;
+
+	alignas(64) std::atomic<uint64_t> m_written;
+	alignas(64) std::atomic<uint64_t> m_read;
+};
+
+Tracer & Tracer::GetInstance()
+{
+	static Tracer inst;
+	return inst;
+}
+
+uint64_t Tracer::NewTraceId() noexcept
+{
+	return gs_nextTraceId.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t Tracer::GetThreadTraceId() noexcept
+{
+	return gt_traceId;
+}
+
+void Tracer::SetThreadTraceId(uint64_t traceId) noexcept
+{
+	gt_traceId = traceId;
+}
+
+Tracer::Clock::time_point Tracer::FromSteady(std::chrono::steady_clock::time_point steadyTime) noexcept
+{
+	return Clock::now() - std::chrono::duration_cast<Clock::duration>(std::chrono::steady_clock::now() - steadyTime);
+}
+
+Tracer::Tracer() :
+	m_isEnabled(false),
+	m_droppedCnt(0),
+	m_file(nullptr),
+	m_processName(),
+	m_pid(GetProcessId()),
+	m_bufferSize(sk_defBufferSize),
+	m_flushInterval(1000),
+	m_bufferMutex(),
+	m_buffers(),
+	m_nextTid(1),
+	m_flushMutex(),
+	m_flushSignal(),
+	m_isStopping(false),
+	m_flushThread()
+{
+}
+
+Tracer::~Tracer()
+{
+	Stop();
+}
+
+void Tracer::Start(const std::string & filePath, const std::string & processName, size_t bufferSize, std::chrono::milliseconds flushInterval)
+{
+	std::unique_lock<std::mutex> flushLock(m_flushMutex);
+	if (m_file != nullptr || m_isStopping)
+	{
+		throw std::runtime_error("The tracer can only be started once.");
+	}
+
+	if (CreateTraceFile(filePath, m_pid))
+	{
+		m_file = std::fopen(filePath.c_str(), "ab");
+	}
+	if (m_file == nullptr)
+	{
+		throw std::runtime_error("Failed to open trace file " + filePath + ".");
+	}
+	//Each flush is one write, so batches from processes sharing the file don't interleave.
+	std::setvbuf(m_file, nullptr, _IONBF, 0);
+
+	const std::string header = "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + std::to_string(m_pid) +
+		",\"tid\":0,\"args\":{\"name\":\"" + processName + "\"}},\n";
+	std::fwrite(header.data(), 1, header.size(), m_file);
+
+	m_processName = processName;
+	m_flushInterval = flushInterval;
+	{
+		std::unique_lock<std::mutex> bufferLock(m_bufferMutex);
+		m_bufferSize = std::max<size_t>(bufferSize, 1);
+	}
+	m_flushThread = std::thread(&Tracer::FlushWorker, this);
+
+	m_isEnabled.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::Stop() noexcept
+{
+	std::unique_lock<std::mutex> flushLock(m_flushMutex);
+	if (m_file == nullptr || m_isStopping)
+	{
+		return;
+	}
+	m_isEnabled.store(false, std::memory_order_relaxed);
+	m_isStopping = true;
+	flushLock.unlock();
+	m_flushSignal.notify_all();
+
+	//The flushing thread writes what's left before it returns.
+	m_flushThread.join();
+
+	flushLock.lock();
+	std::fclose(m_file);
+	m_file = nullptr;
+}
+
+void Tracer::Record(const char * name, Clock::time_point start, Clock::time_point end, uint64_t traceId) noexcept
+{
+	if (IsEnabled())
+	{
+		const uint64_t startUs = ToUs(start);
+		const uint64_t endUs = ToUs(end);
+		Push(name, startUs, endUs > startUs ? endUs - startUs : 0, traceId, false);
+	}
+}
+
+void Tracer::RecordInstant(const char * name, uint64_t traceId) noexcept
+{
+	if (IsEnabled())
+	{
+		Push(name, ToUs(Clock::now()), 0, traceId, true);
+	}
+}
+
+void Tracer::Push(const char * name, uint64_t startUs, uint64_t durUs, uint64_t traceId, bool isInstant) noexcept
+{
+	ThreadBuffer* buffer = GetThreadBuffer();
+	if (buffer == nullptr)
+	{
+		m_droppedCnt.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	const uint64_t written = buffer->m_written.load(std::memory_order_relaxed);
+	if (written - buffer->m_read.load(std::memory_order_acquire) >= buffer->m_events.size())
+	{
+		m_droppedCnt.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	ThreadBuffer::Event& event = buffer->m_events[written % buffer->m_events.size()];
+	event.m_name = name;
+	event.m_startUs = startUs;
+	event.m_durUs = durUs;
+	event.m_traceId = traceId;
+	event.m_isInstant = isInstant;
+
+	buffer->m_written.store(written + 1, std::memory_order_release);
+}
+
+Tracer::ThreadBuffer * Tracer::GetThreadBuffer()
+{
+	//The registry keeps the buffer after the thread exits, until it's drained.
+	thread_local std::shared_ptr<ThreadBuffer> tl_buffer;
+	if (!tl_buffer)
+	{
+		try
+		{
+			std::unique_lock<std::mutex> bufferLock(m_bufferMutex);
+			tl_buffer = std::make_shared<ThreadBuffer>(m_bufferSize, m_nextTid++);
+			m_buffers.push_back(tl_buffer);
+		}
+		catch (const std::exception&)
+		{
+			tl_buffer.reset();
+			return nullptr;
+		}
+	}
+	return tl_buffer.get();
+}
+
+void Tracer::FlushWorker()
+{
+	std::unique_lock<std::mutex> flushLock(m_flushMutex);
+	while (!m_isStopping)
+	{
+		m_flushSignal.wait_for(flushLock, m_flushInterval, [this]() { return m_isStopping; });
+
+		flushLock.unlock();
+		Flush();
+		flushLock.lock();
+	}
+}
+
+void Tracer::Flush()
+{
+	std::vector<std::shared_ptr<ThreadBuffer> > buffers;
+	{
+		std::unique_lock<std::mutex> bufferLock(m_bufferMutex);
+		buffers = m_buffers;
+	}
+
+	const std::string pidStr = std::to_string(m_pid);
+	std::string out;
+	for (const std::shared_ptr<ThreadBuffer>& buffer : buffers)
+	{
+		const uint64_t read = buffer->m_read.load(std::memory_order_relaxed);
+		const uint64_t written = buffer->m_written.load(std::memory_order_acquire);
+		if (read == written)
+		{
+			continue;
+		}
+
+		const std::string tidStr = std::to_string(buffer->m_tid);
+		if (!buffer->m_isNamed)
+		{
+			buffer->m_isNamed = true;
+			out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pidStr + ",\"tid\":" + tidStr +
+				",\"args\":{\"name\":\"" + m_processName + " " + tidStr + "\"}},\n";
+		}
+
+		for (uint64_t i = read; i < written; ++i)
+		{
+			const ThreadBuffer::Event& event = buffer->m_events[i % buffer->m_events.size()];
+			out += "{\"name\":\"";
+			out += event.m_name;
+			out += event.m_isInstant ? "\",\"ph\":\"i\",\"s\":\"t\"" : "\",\"ph\":\"X\",\"dur\":" + std::to_string(event.m_durUs);
+			out += ",\"ts\":" + std::to_string(event.m_startUs) + ",\"pid\":" + pidStr + ",\"tid\":" + tidStr;
+			if (event.m_traceId != 0)
+			{
+				out += ",\"args\":{\"trace\":" + std::to_string(event.m_traceId) + "}";
+			}
+			out += "},\n";
+		}
+		buffer->m_read.store(written, std::memory_order_release);
+	}
+
+	if (out.size() > 0)
+	{
+		std::fwrite(out.data(), 1, out.size(), m_file);
+	}
+
+	//Buffers of threads that have exited are dropped once they are drained.
+	std::unique_lock<std::mutex> bufferLock(m_bufferMutex);
+	buffers.clear();
+	for (auto it = m_buffers.begin(); it != m_buffers.end();)
+	{
+		if (it->use_count() == 1 &&
+			(*it)->m_read.load(std::memory_order_relaxed) == (*it)->m_written.load(std::memory_order_acquire))
+		{
+			it = m_buffers.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+TraceSpan::TraceSpan(const char * name) noexcept :
+	m_name(name),
+	m_isEnabled(Tracer::GetInstance().IsEnabled()),
+	m_start(m_isEnabled ? Tracer::Clock::now() : Tracer::Clock::time_point())
+{
+}
+
+TraceSpan::TraceSpan(const char * name, Tracer::Clock::time_point start) noexcept :
+	m_name(name),
+	m_isEnabled(Tracer::GetInstance().IsEnabled()),
+	m_start(start)
+{
+}
+
+TraceSpan::~TraceSpan()
+{
+	if (m_isEnabled)
+	{
+		Tracer::GetInstance().Record(m_name, m_start, Tracer::Clock::now(), Tracer::GetThreadTraceId());
+	}
+}
+
+TraceIdScope::TraceIdScope(uint64_t traceId) noexcept :
+	m_prevId(Tracer::GetThreadTraceId())
+{
+	Tracer::SetThreadTraceId(traceId);
+}
+
+TraceIdScope::~TraceIdScope()
+{
+	Tracer::SetThreadTraceId(m_prevId);
+}
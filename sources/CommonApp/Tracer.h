@@ -0,0 +1,192 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <condition_variable>
+
+namespace Decent
+{
+	namespace Perf
+	{
+		/**
+		 * \brief	Records timestamped spans and writes them to a file in the Chrome trace-event format
+		 * 			(JSON array), which chrome://tracing and Perfetto can open. It's off until Start() is
+		 * 			called, and recording costs one relaxed load while it's off.
+		 *
+		 * 			Each thread records into its own fixed-size ring buffer without locking; a background
+		 * 			thread drains the buffers to the file. Spans that don't fit in a full buffer are
+		 * 			dropped and counted. Timestamps are wall-clock microseconds, so traces of processes
+		 * 			on the same host line up; several processes may append to the same file.
+		 */
+		class Tracer
+		{
+		public:
+			typedef std::chrono::system_clock Clock;
+
+			static constexpr size_t sk_defBufferSize = 16384;
+
+		public:
+			/** \brief	Gets the tracer of this process. */
+			static Tracer& GetInstance();
+
+			/**
+			 * \brief	Gets a new ID tying the spans of one connection (or request) together.
+			 *
+			 * \return	The ID; never zero.
+			 */
+			static uint64_t NewTraceId() noexcept;
+
+			/**
+			 * \brief	Gets the trace ID of the work being done by the calling thread, which is attached
+			 * 			to the spans it records.
+			 *
+			 * \return	The ID, or zero if there is none.
+			 */
+			static uint64_t GetThreadTraceId() noexcept;
+
+			static void SetThreadTraceId(uint64_t traceId) noexcept;
+
+			/**
+			 * \brief	Converts a steady clock time point (e.g. one taken for the metrics) to the trace's
+			 * 			clock.
+			 */
+			static Clock::time_point FromSteady(std::chrono::steady_clock::time_point steadyTime) noexcept;
+
+		public:
+			Tracer();
+
+			virtual ~Tracer();
+
+			/**
+			 * \brief	Starts recording.
+			 *
+			 * \exception	std::runtime_error	Thrown if the file can't be opened, or it has been started
+			 * 									before; it can only be started once.
+			 *
+			 * \param	filePath	 	Path to the trace file; events are appended to it. It's created
+			 * 							with the opening bracket if it doesn't exist, so it must either
+			 * 							not exist or be a trace written by this tracer before (an empty
+			 * 							file isn't valid). Processes sharing it may start at the same
+			 * 							time.
+			 * \param	processName  	Name of this process shown in the trace.
+			 * \param	bufferSize   	Number of spans each thread can hold until they are written.
+			 * \param	flushInterval	How often the buffers are written to the file.
+			 */
+			void Start(const std::string& filePath, const std::string& processName, size_t bufferSize,
+				std::chrono::milliseconds flushInterval);
+
+			/** \brief	Stops recording, and writes what's left in the buffers. */
+			void Stop() noexcept;
+
+			bool IsEnabled() const noexcept { return m_isEnabled.load(std::memory_order_relaxed); }
+
+			/**
+			 * \brief	Records a span on the calling thread's buffer.
+			 *
+			 * \param	name   	The name; it must be a string literal, since only the pointer is kept.
+			 * \param	start  	When the span started.
+			 * \param	end	   	When the span ended.
+			 * \param	traceId	The trace ID; zero if there is none.
+			 */
+			void Record(const char* name, Clock::time_point start, Clock::time_point end, uint64_t traceId) noexcept;
+
+			/**
+			 * \brief	Records an instant event on the calling thread's buffer.
+			 *
+			 * \param	name   	The name; it must be a string literal.
+			 * \param	traceId	The trace ID; zero if there is none.
+			 */
+			void RecordInstant(const char* name, uint64_t traceId) noexcept;
+
+			/**
+			 * \brief	Gets number of spans dropped because a thread's buffer was full.
+			 *
+			 * \return	The number of dropped spans.
+			 */
+			uint64_t GetDroppedCount() const noexcept { return m_droppedCnt.load(std::memory_order_relaxed); }
+
+		private:
+			struct ThreadBuffer;
+
+			ThreadBuffer* GetThreadBuffer();
+
+			void Push(const char* name, uint64_t startUs, uint64_t durUs, uint64_t traceId, bool isInstant) noexcept;
+
+			void FlushWorker();
+
+			/** \brief	Drains every thread's buffer to the file; only called by the flushing thread. */
+			void Flush();
+
+			std::atomic<bool> m_isEnabled;
+			std::atomic<uint64_t> m_droppedCnt;
+
+			std::FILE* m_file;
+			std::string m_processName;
+			uint32_t m_pid;
+			size_t m_bufferSize;
+			std::chrono::milliseconds m_flushInterval;
+
+			std::mutex m_bufferMutex;
+			std::vector<std::shared_ptr<ThreadBuffer> > m_buffers;
+			uint32_t m_nextTid;
+
+			std::mutex m_flushMutex;
+			std::condition_variable m_flushSignal;
+			bool m_isStopping;
+			std::thread m_flushThread;
+		};
+
+		/**
+		 * \brief	Records a span, from its construction to its destruction, tagged with the calling
+		 * 			thread's trace ID. Nothing is recorded if the tracer is off at construction.
+		 */
+		class TraceSpan
+		{
+		public:
+			/**
+			 * \brief	Constructor
+			 *
+			 * \param	name	The name; it must be a string literal.
+			 */
+			TraceSpan(const char* name) noexcept;
+
+			/**
+			 * \brief	Constructor for a span that started before this object.
+			 *
+			 * \param	name 	The name; it must be a string literal.
+			 * \param	start	When the span started.
+			 */
+			TraceSpan(const char* name, Tracer::Clock::time_point start) noexcept;
+
+			TraceSpan(const TraceSpan& rhs) = delete;
+
+			~TraceSpan();
+
+		private:
+			const char* const m_name;
+			const bool m_isEnabled;
+			const Tracer::Clock::time_point m_start;
+		};
+
+		/** \brief	Sets the calling thread's trace ID for its lifetime, restoring the previous one after. */
+		class TraceIdScope
+		{
+		public:
+			TraceIdScope(uint64_t traceId) noexcept;
+
+			TraceIdScope(const TraceIdScope& rhs) = delete;
+
+			~TraceIdScope();
+
+		private:
+			const uint64_t m_prevId;
+		};
+	}
+}
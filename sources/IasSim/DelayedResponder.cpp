@@ -0,0 +1,162 @@
+#include "DelayedResponder.h"
+
+#include <algorithm>
+
+#include <DecentApi/Common/Common.h>
+#include <DecentApi/Common/Net/ConnectionBase.h>
+#include <DecentApi/Common/Net/RpcWriter.h>
+
+#include "../CommonApp/Tracer.h"
+
+using namespace Decent;
+using namespace Decent::Net;
+using namespace Decent::IasSim;
+
+DelayedResponder::DelayedResponder(size_t threadNum, std::function<void()> onFinished) :
+	m_mutex(),
+	m_signal(),
+	m_pending(),
+	m_finished(),
+	m_isStopped(false),
+	m_onFinished(std::move(onFinished)),
+	m_threads()
+{
+	threadNum = std::max<size_t>(threadNum, 1);
+	for (size_t i = 0; i < threadNum; ++i)
+	{
+		m_threads.emplace_back(&DelayedResponder::DispatchLoop, this);
+	}
+}
+
+DelayedResponder::~DelayedResponder()
+{
+	Stop();
+}
+
+void DelayedResponder::Schedule(Clock::time_point deadline, ConnectionBase & connection, std::shared_ptr<const RpcWriter> rpc, uint64_t traceId)
+{
+	Push(Item{ deadline, &connection, std::move(rpc), traceId });
+}
+
+void DelayedResponder::ScheduleClose(Clock::time_point deadline, ConnectionBase & connection, uint64_t traceId)
+{
+	Push(Item{ deadline, &connection, nullptr, traceId });
+}
+
+void DelayedResponder::Push(const Item & item)
+{
+	bool isEarliest = false;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		isEarliest = m_pending.empty() || item.m_deadline < m_pending.top().m_deadline;
+		m_pending.push(item);
+	}
+
+	//Dispatchers only need to wake up if they are waiting for a later deadline.
+	if (isEarliest)
+	{
+		m_signal.notify_one();
+	}
+}
+
+ConnectionBase * DelayedResponder::PopFinished()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (m_finished.empty())
+	{
+		return nullptr;
+	}
+	ConnectionBase* res = m_finished.back();
+	m_finished.pop_back();
+	return res;
+}
+
+void DelayedResponder::Stop() noexcept
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_isStopped)
+		{
+			return;
+		}
+		m_isStopped = true;
+	}
+	m_signal.notify_all();
+
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+	m_threads.clear();
+
+	//Nothing would ever answer them, so their clients shouldn't be left waiting.
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (!m_pending.empty())
+	{
+		m_pending.top().m_connection->Terminate();
+		m_pending.pop();
+	}
+}
+
+size_t DelayedResponder::GetPendingCount() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_pending.size();
+}
+
+void DelayedResponder::DispatchLoop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (!m_isStopped)
+	{
+		if (m_pending.empty())
+		{
+			m_signal.wait(lock);
+			continue;
+		}
+
+		const Clock::time_point deadline = m_pending.top().m_deadline;
+		if (Clock::now() < deadline)
+		{
+			m_signal.wait_until(lock, deadline);
+			continue;
+		}
+
+		Item item = m_pending.top();
+		m_pending.pop();
+
+		//Let other dispatchers pick up the next one while we are sending.
+		if (!m_pending.empty())
+		{
+			m_signal.notify_one();
+		}
+		lock.unlock();
+
+		bool isSent = false;
+		try
+		{
+			if (item.m_rpc)
+			{
+				Perf::TraceIdScope traceIdScope(item.m_traceId);
+				Perf::TraceSpan span("IasSim.Send");
+				item.m_connection->SendRpc(*item.m_rpc);
+				isSent = true;
+			}
+		}
+		catch (const std::exception& e)
+		{
+			PRINT_I("Failed to send the simulated response. Error Msg: %s", e.what());
+		}
+
+		if (!isSent)
+		{
+			item.m_connection->Terminate();
+		}
+
+		lock.lock();
+		m_finished.push_back(item.m_connection);
+		lock.unlock();
+		m_onFinished();
+		lock.lock();
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <mutex>
+#include <queue>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <cstdint>
+#include <condition_variable>
+#include <functional>
+
+namespace Decent
+{
+	namespace Net
+	{
+		class ConnectionBase;
+		class RpcWriter;
+	}
+
+	namespace IasSim
+	{
+		/**
+		 * \brief	Sends prebuilt responses once their deadline is reached. Requests are parked in a
+		 * 			deadline queue instead of sleeping on a worker thread, so a few dispatcher threads
+		 * 			can serve a large number of concurrent simulated calls.
+		 */
+		class DelayedResponder
+		{
+		public:
+			typedef std::chrono::steady_clock Clock;
+
+		public:
+			/**
+			 * \brief	Constructor
+			 *
+			 * \param	threadNum 	Number of dispatcher threads (at least one is started).
+			 * \param	onFinished	Called by a dispatcher thread each time a connection is added to the
+			 * 						finished ones, so it can be given back without waiting for another
+			 * 						request; it must not throw.
+			 */
+			DelayedResponder(size_t threadNum, std::function<void()> onFinished);
+
+			virtual ~DelayedResponder();
+
+			/**
+			 * \brief	Schedules a response. The connection must stay alive until it's returned by
+			 * 			PopFinished, or until this responder is stopped.
+			 *
+			 * \param	deadline  	When the response should be sent.
+			 * \param	connection	The connection to respond on.
+			 * \param	rpc		  	The response; it's shared, so a prebuilt one can be sent on many
+			 * 						connections.
+			 * \param	traceId   	The trace ID of the request, attached to the span of sending; zero if
+			 * 						there is none.
+			 */
+			void Schedule(Clock::time_point deadline, Net::ConnectionBase& connection, std::shared_ptr<const Net::RpcWriter> rpc, uint64_t traceId);
+
+			/**
+			 * \brief	Schedules closing a connection without a response, i.e. a simulated failure. The
+			 * 			connection must stay alive as in Schedule. A responded connection is left open, so
+			 * 			the client can keep it alive; a closed one is still returned by PopFinished.
+			 *
+			 * \param	deadline  	When the connection should be closed.
+			 * \param	connection	The connection.
+			 * \param	traceId   	The trace ID of the request; zero if there is none.
+			 */
+			void ScheduleClose(Clock::time_point deadline, Net::ConnectionBase& connection, uint64_t traceId);
+
+			/**
+			 * \brief	Takes a connection that has been responded to, if there is any.
+			 *
+			 * \return	The connection, or nullptr if none is ready yet.
+			 */
+			Net::ConnectionBase* PopFinished();
+
+			/**
+			 * \brief	Stops all dispatcher threads. Responses that are still pending are dropped, and
+			 * 			their connections are closed.
+			 */
+			void Stop() noexcept;
+
+			size_t GetPendingCount() const;
+
+		private:
+			struct Item
+			{
+				Clock::time_point m_deadline;
+				Net::ConnectionBase* m_connection;
+				/** \brief	The response; nullptr to close without a response. */
+				std::shared_ptr<const Net::RpcWriter> m_rpc;
+
+				uint64_t m_traceId;
+
+				bool operator>(const Item& rhs) const noexcept
+				{
+					return m_deadline > rhs.m_deadline;
+				}
+			};
+
+			void Push(const Item& item);
+
+			void DispatchLoop();
+
+			mutable std::mutex m_mutex;
+			std::condition_variable m_signal;
+			std::priority_queue<Item, std::vector<Item>, std::greater<Item> > m_pending;
+			std::vector<Net::ConnectionBase*> m_finished;
+			bool m_isStopped;
+			std::function<void()> m_onFinished;
+
+			std::vector<std::thread> m_threads;
+		};
+	}
+}
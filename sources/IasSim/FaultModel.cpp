@@ -0,0 +1,276 @@
+#include "FaultModel.h"
+
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+#include <json/json.h>
+
+#include <DecentApi/Common/Common.h>
+
+using namespace Decent;
+using namespace Decent::IasSim;
+
+namespace
+{
+	static std::mt19937& GetRandomGenerator()
+	{
+		static thread_local std::random_device rd;
+		static thread_local std::mt19937 generator(rd());
+		return generator;
+	}
+
+	static bool SampleChance(double probability)
+	{
+		if (probability <= 0.0)
+		{
+			return false;
+		}
+		return std::uniform_real_distribution<double>(0.0, 1.0)(GetRandomGenerator()) < probability;
+	}
+
+	static double GetOptNumber(const Json::Value& json, const char* key, double defaultVal, double max)
+	{
+		if (!json.isMember(key))
+		{
+			return defaultVal;
+		}
+		if (!json[key].isNumeric() || json[key].asDouble() < 0.0 || json[key].asDouble() > max)
+		{
+			throw std::runtime_error(std::string("Fault field \"") + key + "\" must be a number between 0 and " + std::to_string(max) + ".");
+		}
+		return json[key].asDouble();
+	}
+
+	static FaultSpec ParseFaultSpec(const Json::Value& json)
+	{
+		if (!json.isObject())
+		{
+			throw std::runtime_error("A fault spec must be an object.");
+		}
+
+		constexpr double maxVal = 1e12;
+		FaultSpec spec;
+		spec.m_rateLimit = GetOptNumber(json, "RateLimit", spec.m_rateLimit, maxVal);
+		spec.m_burst = GetOptNumber(json, "Burst", spec.m_burst, maxVal);
+		spec.m_capacity = static_cast<size_t>(GetOptNumber(json, "Capacity", 0.0, maxVal));
+		spec.m_queueLimit = static_cast<size_t>(GetOptNumber(json, "QueueLimit", 0.0, maxVal));
+		spec.m_errorRate = GetOptNumber(json, "ErrorRate", spec.m_errorRate, 1.0);
+		spec.m_dropRate = GetOptNumber(json, "DropRate", spec.m_dropRate, 1.0);
+		spec.m_dropAfter = LatencyModel::Duration(GetOptNumber(json, "DropAfter", spec.m_dropAfter.count(), maxVal));
+		return spec;
+	}
+
+	static double GetBurst(const FaultSpec& spec)
+	{
+		return spec.m_burst > 0.0 ? spec.m_burst : std::max(spec.m_rateLimit, 1.0);
+	}
+}
+
+FaultModel::FaultModel(std::vector<Phase> phases, bool isLoop) :
+	m_phases(std::move(phases)),
+	m_cycleLength(Clock::duration::zero()),
+	m_isLoop(isLoop),
+	m_start(Clock::now()),
+	m_mutex(),
+	m_phaseIndex(0),
+	m_tokens(0.0),
+	m_lastRefill(m_start),
+	m_slotFreeTimes(),
+	m_queuedStarts(),
+	m_respondedCnt(0),
+	m_rateLimitedCnt(0),
+	m_queueFullCnt(0),
+	m_errorCnt(0),
+	m_dropCnt(0),
+	m_peakQueued(0)
+{
+	if (m_phases.empty())
+	{
+		throw std::runtime_error("A phased fault model needs at least one phase.");
+	}
+	for (const Phase& phase : m_phases)
+	{
+		m_cycleLength += phase.m_length;
+	}
+	if (m_isLoop && m_cycleLength <= Clock::duration::zero())
+	{
+		throw std::runtime_error("A looped phased fault model must not have zero length.");
+	}
+
+	EnterPhase(0, m_start);
+}
+
+FaultModel::FaultModel() :
+	FaultModel(std::vector<Phase>{ Phase{ Clock::duration::zero(), FaultSpec() } }, false)
+{
+}
+
+FaultModel::~FaultModel()
+{
+}
+
+FaultModel::Decision FaultModel::Admit(Clock::time_point now, LatencyModel::Duration latency)
+{
+	const Clock::duration serviceTime = std::chrono::duration_cast<Clock::duration>(latency);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	const size_t phaseIndex = GetPhaseIndex(now);
+	if (phaseIndex != m_phaseIndex)
+	{
+		EnterPhase(phaseIndex, now);
+	}
+	const FaultSpec& spec = m_phases[m_phaseIndex].m_spec;
+
+	//Rate limiter:
+	if (spec.m_rateLimit > 0.0)
+	{
+		const double elapsed = std::chrono::duration<double>(now - m_lastRefill).count();
+		m_tokens = std::min(GetBurst(spec), m_tokens + (elapsed > 0.0 ? elapsed * spec.m_rateLimit : 0.0));
+		m_lastRefill = std::max(m_lastRefill, now);
+		if (m_tokens < 1.0)
+		{
+			m_rateLimitedCnt.fetch_add(1, std::memory_order_relaxed);
+			return Decision{ Outcome::RateLimited, now };
+		}
+		m_tokens -= 1.0;
+	}
+
+	//A dropped request never reaches a service slot.
+	if (SampleChance(spec.m_dropRate))
+	{
+		m_dropCnt.fetch_add(1, std::memory_order_relaxed);
+		return Decision{ Outcome::Drop, now + std::chrono::duration_cast<Clock::duration>(spec.m_dropAfter) };
+	}
+
+	//Service slots and the queue in front of them:
+	Clock::time_point finish = now + serviceTime;
+	if (spec.m_capacity > 0)
+	{
+		m_queuedStarts.erase(std::remove_if(m_queuedStarts.begin(), m_queuedStarts.end(),
+			[now](const Clock::time_point& start) { return start <= now; }), m_queuedStarts.end());
+
+		const Clock::time_point start = std::max(now, m_slotFreeTimes.front());
+		if (start > now)
+		{
+			if (m_queuedStarts.size() >= spec.m_queueLimit)
+			{
+				m_queueFullCnt.fetch_add(1, std::memory_order_relaxed);
+				return Decision{ Outcome::QueueFull, now };
+			}
+			m_queuedStarts.push_back(start);
+
+			const uint64_t queued = m_queuedStarts.size();
+			if (queued > m_peakQueued.load(std::memory_order_relaxed))
+			{
+				m_peakQueued.store(queued, std::memory_order_relaxed);
+			}
+		}
+
+		finish = start + serviceTime;
+		std::pop_heap(m_slotFreeTimes.begin(), m_slotFreeTimes.end(), std::greater<Clock::time_point>());
+		m_slotFreeTimes.back() = finish;
+		std::push_heap(m_slotFreeTimes.begin(), m_slotFreeTimes.end(), std::greater<Clock::time_point>());
+	}
+
+	if (SampleChance(spec.m_errorRate))
+	{
+		m_errorCnt.fetch_add(1, std::memory_order_relaxed);
+		return Decision{ Outcome::Error, finish };
+	}
+
+	m_respondedCnt.fetch_add(1, std::memory_order_relaxed);
+	return Decision{ Outcome::Respond, finish };
+}
+
+void FaultModel::PrintStats() const
+{
+	PRINT_I("Simulated IAS requests - responded: %llu, rate limited: %llu, queue full: %llu, errors: %llu, drops: %llu, peak queued: %llu.",
+		static_cast<unsigned long long>(m_respondedCnt.load()),
+		static_cast<unsigned long long>(m_rateLimitedCnt.load()),
+		static_cast<unsigned long long>(m_queueFullCnt.load()),
+		static_cast<unsigned long long>(m_errorCnt.load()),
+		static_cast<unsigned long long>(m_dropCnt.load()),
+		static_cast<unsigned long long>(m_peakQueued.load()));
+}
+
+size_t FaultModel::GetPhaseIndex(Clock::time_point now) const
+{
+	auto elapsed = now > m_start ? now - m_start : Clock::duration::zero();
+	if (m_isLoop)
+	{
+		elapsed %= m_cycleLength;
+	}
+
+	for (size_t i = 0; i < m_phases.size(); ++i)
+	{
+		if (elapsed < m_phases[i].m_length)
+		{
+			return i;
+		}
+		elapsed -= m_phases[i].m_length;
+	}
+	return m_phases.size() - 1;
+}
+
+void FaultModel::EnterPhase(size_t index, Clock::time_point now)
+{
+	m_phaseIndex = index;
+	const FaultSpec& spec = m_phases[index].m_spec;
+
+	//A new phase starts with a full bucket.
+	m_tokens = GetBurst(spec);
+	m_lastRefill = now;
+
+	//Requests in service or queued stay scheduled; only the number of slots changes. Shrinking drops the
+	//slots that get free first, growing adds slots that are free now.
+	std::sort_heap(m_slotFreeTimes.begin(), m_slotFreeTimes.end(), std::greater<Clock::time_point>());
+	while (m_slotFreeTimes.size() > spec.m_capacity)
+	{
+		m_slotFreeTimes.pop_back();
+	}
+	while (m_slotFreeTimes.size() < spec.m_capacity)
+	{
+		m_slotFreeTimes.push_back(now);
+	}
+	std::make_heap(m_slotFreeTimes.begin(), m_slotFreeTimes.end(), std::greater<Clock::time_point>());
+}
+
+std::shared_ptr<FaultModel> IasSim::ParseFaultJson(const Json::Value & json)
+{
+	if (!json.isObject())
+	{
+		throw std::runtime_error("A fault model must be an object.");
+	}
+
+	if (!json.isMember("Phases"))
+	{
+		return std::make_shared<FaultModel>(std::vector<FaultModel::Phase>{ FaultModel::Phase{ FaultModel::Clock::duration::zero(), ParseFaultSpec(json) } }, false);
+	}
+
+	if (!json["Phases"].isArray() || json["Phases"].empty())
+	{
+		throw std::runtime_error("The \"Phases\" of a fault model must be a non-empty array.");
+	}
+
+	std::vector<FaultModel::Phase> phases;
+	for (const Json::Value& phaseJson : json["Phases"])
+	{
+		if (!phaseJson.isObject() || !phaseJson["Duration"].isNumeric() || phaseJson["Duration"].asDouble() < 0.0)
+		{
+			throw std::runtime_error("Each fault phase needs a non-negative \"Duration\" in seconds.");
+		}
+
+		FaultModel::Phase phase;
+		phase.m_length = std::chrono::duration_cast<FaultModel::Clock::duration>(
+			std::chrono::duration<double>(phaseJson["Duration"].asDouble()));
+		phase.m_spec = phaseJson.isMember("Faults") ? ParseFaultSpec(phaseJson["Faults"]) : FaultSpec();
+		phases.push_back(std::move(phase));
+	}
+
+	const bool isLoop = json.isMember("Loop") ? json["Loop"].asBool() : false;
+
+	return std::make_shared<FaultModel>(std::move(phases), isLoop);
+}
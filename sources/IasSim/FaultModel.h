@@ -0,0 +1,141 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "LatencyModel.h"
+
+namespace Json
+{
+	class Value;
+}
+
+namespace Decent
+{
+	namespace IasSim
+	{
+		/** \brief	How a simulated IAS degrades. The default value has no faults at all. */
+		struct FaultSpec
+		{
+			/** \brief	Requests accepted per second (token bucket); zero means unlimited. */
+			double m_rateLimit = 0.0;
+			/** \brief	Size of the token bucket; zero means one second worth of requests. */
+			double m_burst = 0.0;
+			/** \brief	Number of requests served at once; zero means unlimited (no queueing). */
+			size_t m_capacity = 0;
+			/** \brief	Number of requests waiting for a free slot, beyond which requests are rejected. */
+			size_t m_queueLimit = 0;
+			/** \brief	Probability that an accepted request fails after being served. */
+			double m_errorRate = 0.0;
+			/** \brief	Probability that an accepted request is never answered. */
+			double m_dropRate = 0.0;
+			/** \brief	How long a dropped request hangs before its connection is closed. */
+			LatencyModel::Duration m_dropAfter = LatencyModel::Duration(30000.0);
+		};
+
+		/**
+		 * \brief	Decides the fate of each simulated IAS request: the service is a FIFO queue in front
+		 * 			of a limited number of slots, behind a rate limiter, and it fails or drops a share of
+		 * 			the requests. The spec can change in phases over time, like PhasedLatency.
+		 *
+		 * 			Admit may be called concurrently.
+		 */
+		class FaultModel
+		{
+		public:
+			typedef std::chrono::steady_clock Clock;
+
+			enum class Outcome
+			{
+				Respond,
+				RateLimited,
+				QueueFull,
+				Error,
+				Drop,
+			};
+
+			struct Decision
+			{
+				Outcome m_outcome;
+				/** \brief	When the response is sent (Respond), or when the connection is closed. */
+				Clock::time_point m_deadline;
+			};
+
+			struct Phase
+			{
+				Clock::duration m_length;
+				FaultSpec m_spec;
+			};
+
+		public:
+			/**
+			 * \brief	Constructor
+			 *
+			 * \param	phases	The phases, in order. Must not be empty.
+			 * \param	isLoop	True to start over after the last phase, otherwise the last phase lasts forever.
+			 */
+			FaultModel(std::vector<Phase> phases, bool isLoop);
+
+			/** \brief	Constructs a model without faults. */
+			FaultModel();
+
+			virtual ~FaultModel();
+
+			/**
+			 * \brief	Decides what happens to a request that has just arrived.
+			 *
+			 * \param	now	   	The arrival time.
+			 * \param	latency	The service time sampled for the request.
+			 *
+			 * \return	The decision. Every outcome other than Respond means the connection is closed
+			 * 			without a response at the deadline.
+			 */
+			Decision Admit(Clock::time_point now, LatencyModel::Duration latency);
+
+			/** \brief	Prints the counters. */
+			void PrintStats() const;
+
+		private:
+			size_t GetPhaseIndex(Clock::time_point now) const;
+
+			void EnterPhase(size_t index, Clock::time_point now);
+
+			std::vector<Phase> m_phases;
+			Clock::duration m_cycleLength;
+			bool m_isLoop;
+			Clock::time_point m_start;
+
+			std::mutex m_mutex;
+			size_t m_phaseIndex;
+			double m_tokens;
+			Clock::time_point m_lastRefill;
+			/** \brief	Min-heap of the times each service slot gets free. */
+			std::vector<Clock::time_point> m_slotFreeTimes;
+			/** \brief	Start times of the queued requests, in order. */
+			std::vector<Clock::time_point> m_queuedStarts;
+
+			std::atomic<uint64_t> m_respondedCnt;
+			std::atomic<uint64_t> m_rateLimitedCnt;
+			std::atomic<uint64_t> m_queueFullCnt;
+			std::atomic<uint64_t> m_errorCnt;
+			std::atomic<uint64_t> m_dropCnt;
+			std::atomic<uint64_t> m_peakQueued;
+		};
+
+		/**
+		 * \brief	Constructs a fault model from JSON. It's either an object of fault fields,
+		 * 			{"RateLimit" : PER_SECOND, "Burst" : N, "Capacity" : N, "QueueLimit" : N,
+		 * 			"ErrorRate" : P, "DropRate" : P, "DropAfter" : MS}, all optional, or an object like
+		 * 			{"Phases" : [{"Duration" : SECONDS, "Faults" : FIELDS}, ...], "Loop" : true}.
+		 *
+		 * \exception	std::runtime_error	Thrown if the JSON is invalid.
+		 *
+		 * \param	json	The JSON value.
+		 *
+		 * \return	The fault model.
+		 */
+		std::shared_ptr<FaultModel> ParseFaultJson(const Json::Value& json);
+	}
+}
@@ -1,185 +1,193 @@
 #include "IasSimApp.h"
 
 #include <chrono>
-#include <thread>
-#include <random>
+#include <stdexcept>
 
 #include <DecentApi/Common/Common.h>
 #include <DecentApi/Common/Net/ConnectionBase.h>
+#include <DecentApi/CommonApp/Net/TCPConnection.h>
+
+#include "../CommonApp/Tracer.h"
 
 #include "IasRespSamples.h"
 
 using namespace Decent;
 using namespace Decent::Net;
 using namespace Decent::IasSim;
-
-//#define TURN_OFF_DELAY_SIMULATION
+using namespace Decent::Perf;
 
 namespace
 {
-	static constexpr double CalcSquare(double x)
-	{
-		return x * x;
-	}
+	/** \brief	Category of the message that gives one finished connection back to the smart server. */
+	static constexpr char gsk_releaseCategory[] = "IasSim.Release";
 
-	/**
-	 * \brief	Calculates the alpha for gamma distribution. Based on
-	 * 			https://stats.stackexchange.com/questions/107679/how-to-get-only-positive-values-when-imputing-data
-	 *
-	 * \param	avg   	The average.
-	 * \param	stdDev	The standard deviation.
-	 *
-	 * \return	The calculated alpha.
-	 */
-	static constexpr double CalcAlpha(double avg, double stdDev)
+	static std::shared_ptr<const RpcWriter> MakeSigRlRpc()
 	{
-		return CalcSquare(avg / stdDev);
-	}
-
-	/**
-	 * \brief	Calculates the beta for gamma distribution. Based on
-	 * 			https://stats.stackexchange.com/questions/107679/how-to-get-only-positive-values-when-imputing-data
-	 *
-	 * \param	avg   	The average.
-	 * \param	stdDev	The standard deviation.
-	 *
-	 * \return	The calculated beta.
-	 */
-	static constexpr double CalcBeta(double avg, double stdDev)
-	{
-		return CalcSquare(stdDev) / avg;
-	}
+		std::shared_ptr<RpcWriter> rpc = std::make_shared<RpcWriter>(RpcWriter::CalcSizeStr(sizeof(gsk_sigRl) - 1), 1);
 
-	static std::chrono::duration<double, std::milli> GetSigRlDelay()
-	{
-#ifndef TURN_OFF_DELAY_SIMULATION
-		//Average value calculated based on the data collected from the IAS web portal
-		static constexpr auto avg = 39.00; // ms;
+		auto sigRlStr = rpc->AddStringArg(sizeof(gsk_sigRl) - 1);
 
-		//Standard deviation calculated based on the data collected from the IAS web portal
-		static constexpr auto stdDev = 23.79;
+		sigRlStr.Fill(gsk_sigRl);
 
-		static constexpr auto alpha = CalcAlpha(avg, stdDev);
-		static constexpr auto beta = CalcBeta(avg, stdDev);
+		return rpc;
+	}
 
-		static thread_local std::random_device rd;
-		static thread_local std::mt19937 generator(rd());
-		static thread_local std::gamma_distribution<double> dist(alpha, beta);
+	static std::shared_ptr<const RpcWriter> MakeReportRpc(const std::string& report, const std::string& signature, const std::string& cert)
+	{
+		std::shared_ptr<RpcWriter> rpc = std::make_shared<RpcWriter>(RpcWriter::CalcSizeStr(report.size()) +
+			RpcWriter::CalcSizeStr(signature.size()) +
+			RpcWriter::CalcSizeStr(cert.size()), 3);
 
-		double result = dist(generator);
-		while (result > 10000.00)
-		{
-			PRINT_I("Discarded a too large sample - %f", result);
-			result = dist(generator);
-		}
+		auto reportStr = rpc->AddStringArg(report.size());
+		auto signStr = rpc->AddStringArg(signature.size());
+		auto certStr = rpc->AddStringArg(cert.size());
 
-		return std::chrono::duration<double, std::milli>(result);
-#else
-		using namespace std::chrono_literals;
-		return 0ms;
-#endif // !TURN_OFF_DELAY_SIMULATION
+		reportStr.Fill(report.c_str());
+		signStr.Fill(signature.c_str());
+		certStr.Fill(cert.c_str());
 
+		return rpc;
 	}
+}
 
-	static std::chrono::duration<double, std::milli> GetReportDelay()
-	{
-#ifndef TURN_OFF_DELAY_SIMULATION
-		//Average value calculated based on the data collected from the IAS web portal
-		constexpr auto avg = 255.43; // ms;
-
-		//Standard deviation calculated based on the data collected from the IAS web portal
-		constexpr auto stdDev = 70.00;
+IasSimApp::IasSimApp(std::shared_ptr<LatencyModel> sigRlLatency, std::shared_ptr<LatencyModel> reportLatency,
+	std::shared_ptr<FaultModel> faults, size_t dispatcherNum, std::shared_ptr<const ReportSigner> signer) :
+	m_sigRlRpc(MakeSigRlRpc()),
+	m_reportRpc(MakeReportRpc(gsk_report, gsk_signature, gsk_cert)),
+	m_signer(signer),
+	m_invalidCnt(0),
+	m_sigRlLatency(sigRlLatency),
+	m_reportLatency(reportLatency),
+	m_faults(faults),
+	m_releaseMutex(),
+	m_releaseChannel(),
+	m_responder(dispatcherNum, [this]() { SendRelease(); })
+{
+}
 
-		static constexpr auto alpha = CalcAlpha(avg, stdDev);
-		static constexpr auto beta = CalcBeta(avg, stdDev);
+IasSimApp::~IasSimApp()
+{
+}
 
-		static thread_local std::random_device rd;
-		static thread_local std::mt19937 generator(rd());
-		static thread_local std::gamma_distribution<double> dist(alpha, beta);
+bool IasSimApp::ProcessSmartMessage(const std::string & category, Net::ConnectionBase & connection, Net::ConnectionBase *& freeHeldCnt)
+{
+	const auto start = DelayedResponder::Clock::now();
+	const uint64_t traceId = Tracer::GetInstance().IsEnabled() ? Tracer::NewTraceId() : 0;
+	TraceIdScope traceIdScope(traceId);
 
-		double result = dist(generator);
-		while (result > 10000.00)
+	if (category == "SigRl")
+	{
 		{
-			PRINT_I("Discarded a too large sample - %f", result);
-			result = dist(generator);
+			TraceSpan span("IasSim.Recv");
+			std::string gidStr = connection.RecvContainer<std::string>();
 		}
 
-		return std::chrono::duration<double, std::milli>(result);
-#else
-		using namespace std::chrono_literals;
-		return 0ms;
-#endif // !TURN_OFF_DELAY_SIMULATION
+		Schedule(start, connection, *m_sigRlLatency, m_sigRlRpc, "IasSim.SigRl", traceId);
 	}
-
-	static std::chrono::duration<double, std::milli> GetSigRlDelayNeeded()
+	else if (category == "Report")
 	{
-		using namespace std::chrono_literals;
-
-		auto start = std::chrono::high_resolution_clock::now();
-		auto sampleDelay = GetSigRlDelay();
-		auto end = std::chrono::high_resolution_clock::now();
+		std::string reqStr;
+		{
+			TraceSpan span("IasSim.Recv");
+			reqStr = connection.RecvContainer<std::string>();
+		}
 
-		std::chrono::duration<double, std::milli> elapsed = end - start;
+		std::shared_ptr<const RpcWriter> rpc = m_reportRpc;
+		if (m_signer)
+		{
+			try
+			{
+				TraceSpan span("IasSim.Sign");
+				std::string report;
+				std::string signature;
+				m_signer->Sign(reqStr, report, signature);
+				rpc = MakeReportRpc(report, signature, m_signer->GetCertChain());
+			}
+			catch (const std::invalid_argument&)
+			{
+				//Not worth a log line each, at the rates the simulator runs at; they are counted instead.
+				m_invalidCnt.fetch_add(1, std::memory_order_relaxed);
+				m_responder.ScheduleClose(start, connection, traceId);
+				rpc.reset();
+			}
+		}
 
-		auto needed = sampleDelay - elapsed;
-		return needed > 0ms ? needed : 0ms;
+		if (rpc)
+		{
+			Schedule(start, connection, *m_reportLatency, rpc, "IasSim.Report", traceId);
+		}
 	}
-
-	static std::chrono::duration<double, std::milli> GetReportDelayNeeded()
+	else if (category == gsk_releaseCategory)
 	{
-		using namespace std::chrono_literals;
-
-		auto start = std::chrono::high_resolution_clock::now();
-		auto sampleDelay = GetReportDelay();
-		auto end = std::chrono::high_resolution_clock::now();
-
-		std::chrono::duration<double, std::milli> elapsed = end - start;
-
-		auto needed = sampleDelay - elapsed;
-		return needed > 0ms ? needed : 0ms;
+		freeHeldCnt = m_responder.PopFinished();
+		return false;
+	}
+	else
+	{
+		return false;
 	}
+
+	return true;
 }
 
-IasSimApp::IasSimApp() :
-	m_sigRlRpc(RpcWriter::CalcSizeStr(sizeof(gsk_sigRl) - 1), 1),
-	m_reportRpc(RpcWriter::CalcSizeStr(sizeof(gsk_report) - 1) +
-		RpcWriter::CalcSizeStr(sizeof(gsk_signature)) +
-		RpcWriter::CalcSizeStr(sizeof(gsk_cert)), 3)
+void IasSimApp::ConnectReleaseChannel(uint32_t ipAddr, uint16_t port)
 {
-	auto sigRlStr = m_sigRlRpc.AddStringArg(sizeof(gsk_sigRl) - 1);
-
-	sigRlStr.Fill(gsk_sigRl);
-
-	auto reportStr = m_reportRpc.AddStringArg(sizeof(gsk_report) - 1);
-	auto signStr = m_reportRpc.AddStringArg(sizeof(gsk_signature) - 1);
-	auto certStr = m_reportRpc.AddStringArg(sizeof(gsk_cert) - 1);
+	std::unique_ptr<ConnectionBase> channel = std::make_unique<TCPConnection>(ipAddr, port);
 
-	reportStr.Fill(gsk_report);
-	signStr.Fill(gsk_signature);
-	certStr.Fill(gsk_cert);
+	std::unique_lock<std::mutex> lock(m_releaseMutex);
+	m_releaseChannel = std::move(channel);
 }
 
-IasSimApp::~IasSimApp()
+void IasSimApp::Terminate() noexcept
 {
+	m_responder.Stop();
+
+	std::unique_lock<std::mutex> lock(m_releaseMutex);
+	if (m_releaseChannel)
+	{
+		m_releaseChannel->Terminate();
+		m_releaseChannel.reset();
+	}
 }
 
-bool IasSimApp::ProcessSmartMessage(const std::string & category, Net::ConnectionBase & connection, Net::ConnectionBase *& freeHeldCnt)
+void IasSimApp::SendRelease() noexcept
 {
-	if (category == "SigRl")
+	std::unique_lock<std::mutex> lock(m_releaseMutex);
+	if (!m_releaseChannel)
 	{
-		std::string gidStr = connection.RecvContainer<std::string>();
-
-		std::this_thread::sleep_for(GetSigRlDelayNeeded());
+		return;
+	}
 
-		connection.SendRpc(m_sigRlRpc);
+	try
+	{
+		m_releaseChannel->SendContainer(std::string(gsk_releaseCategory));
 	}
-	else if (category == "Report")
+	catch (const std::exception& e)
 	{
-		std::string reqStr = connection.RecvContainer<std::string>();
+		PRINT_W("Failed to send on the release channel; finished connections will stay held. Error Msg: %s", e.what());
+		m_releaseChannel.reset();
+	}
+}
 
-		std::this_thread::sleep_for(GetReportDelayNeeded());
+void IasSimApp::Schedule(DelayedResponder::Clock::time_point start, Net::ConnectionBase & connection,
+	LatencyModel & latency, std::shared_ptr<const Net::RpcWriter> rpc, const char* spanName, uint64_t traceId)
+{
+	const FaultModel::Decision decision = m_faults->Admit(start, latency.Sample());
+
+	//The simulated service time is known up front, so its span is recorded right away.
+	if (traceId != 0)
+	{
+		Tracer::GetInstance().Record(decision.m_outcome == FaultModel::Outcome::Respond ? spanName : "IasSim.Fault",
+			Tracer::FromSteady(start), Tracer::FromSteady(decision.m_deadline), traceId);
+	}
 
-		connection.SendRpc(m_reportRpc);
+	if (decision.m_outcome == FaultModel::Outcome::Respond)
+	{
+		m_responder.Schedule(decision.m_deadline, connection, std::move(rpc), traceId);
+	}
+	else
+	{
+		//There is no status code in the simulator's protocol; the client sees a failed call either way.
+		m_responder.ScheduleClose(decision.m_deadline, connection, traceId);
 	}
-	return false;
 }
@@ -4,6 +4,16 @@
 
 #include <DecentApi/Common/Net/RpcWriter.h>
 
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+#include "DelayedResponder.h"
+#include "LatencyModel.h"
+#include "FaultModel.h"
+#include "ReportSigner.h"
+
 namespace Decent
 {
 	namespace IasSim
@@ -11,15 +21,86 @@ namespace Decent
 		class IasSimApp : public Net::ConnectionHandler
 		{
 		public:
-			IasSimApp();
+			/**
+			 * \brief	Constructor
+			 *
+			 * \param	sigRlLatency 	The latency model of SigRL requests.
+			 * \param	reportLatency	The latency model of report requests.
+			 * \param	faults		 	The fault model shared by both kinds of requests.
+			 * \param	dispatcherNum	Number of threads sending the delayed responses.
+			 * \param	signer		 	Builds a signed report for each report request; nullptr to send the
+			 * 							same canned report to every request.
+			 */
+			IasSimApp(std::shared_ptr<LatencyModel> sigRlLatency, std::shared_ptr<LatencyModel> reportLatency,
+				std::shared_ptr<FaultModel> faults, size_t dispatcherNum, std::shared_ptr<const ReportSigner> signer);
 
 			virtual ~IasSimApp();
 
+			/**
+			 * \brief	Reads the request, and parks the connection until its simulated delay is over.
+			 * 			Requests failed by the fault model are closed without a response instead.
+			 * 			Reports are signed on the calling thread before it's parked, so the time spent on
+			 * 			signing is part of the simulated delay, rather than added to it.
+			 * 			The connection is held by this handler (i.e. true is returned) until the response
+			 * 			is sent. Each finished connection is given back through freeHeldCnt of a release
+			 * 			message, which the dispatcher sends on the release channel (see
+			 * 			ConnectReleaseChannel), so it's kept alive for its next request.
+			 */
 			virtual bool ProcessSmartMessage(const std::string& category, Net::ConnectionBase& connection, Net::ConnectionBase*& freeHeldCnt) override;
 
+			/**
+			 * \brief	Connects the release channel, i.e. a connection from this simulator to its own
+			 * 			server, on which a release message is sent for each finished connection. Without
+			 * 			it, finished connections stay held by this handler.
+			 *
+			 * \param	ipAddr	The IP address of the server.
+			 * \param	port  	The port of the server.
+			 */
+			void ConnectReleaseChannel(uint32_t ipAddr, uint16_t port);
+
+			/** \brief	Stops sending responses. It must be called before the smart server is terminated. */
+			virtual void Terminate() noexcept;
+
+			const FaultModel& GetFaultModel() const noexcept { return *m_faults; }
+
+			/**
+			 * \brief	Gets number of report requests rejected by the signer, i.e. ones IAS would answer
+			 * 			with 400; they are closed without a response.
+			 *
+			 * \return	The number of invalid requests.
+			 */
+			uint64_t GetInvalidCount() const noexcept { return m_invalidCnt.load(std::memory_order_relaxed); }
+
 		private:
-			Net::RpcWriter m_sigRlRpc;
-			Net::RpcWriter m_reportRpc;
+			/**
+			 * \brief	Decides the outcome of a request, and schedules it.
+			 *
+			 * \param 		  	start	  	When the request arrived.
+			 * \param [in,out]	connection	The connection.
+			 * \param [in,out]	latency   	The latency model of the request's kind.
+			 * \param 		  	rpc		  	The response.
+			 * \param 		  	spanName  	Name of the trace span covering the simulated service time.
+			 * \param 		  	traceId   	The trace ID of the request; zero if tracing is off.
+			 */
+			void Schedule(DelayedResponder::Clock::time_point start, Net::ConnectionBase& connection,
+				LatencyModel& latency, std::shared_ptr<const Net::RpcWriter> rpc, const char* spanName, uint64_t traceId);
+
+			/** \brief	Called by the dispatcher threads for each finished connection. */
+			void SendRelease() noexcept;
+
+			std::shared_ptr<const Net::RpcWriter> m_sigRlRpc;
+			std::shared_ptr<const Net::RpcWriter> m_reportRpc;
+			std::shared_ptr<const ReportSigner> m_signer;
+			std::atomic<uint64_t> m_invalidCnt;
+
+			std::shared_ptr<LatencyModel> m_sigRlLatency;
+			std::shared_ptr<LatencyModel> m_reportLatency;
+			std::shared_ptr<FaultModel> m_faults;
+
+			std::mutex m_releaseMutex;
+			std::unique_ptr<Net::ConnectionBase> m_releaseChannel;
+
+			DelayedResponder m_responder;
 		};
 	}
 }
@@ -0,0 +1,277 @@
+#include "LatencyModel.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <json/json.h>
+
+#include <DecentApi/Common/Common.h>
+
+using namespace Decent;
+using namespace Decent::IasSim;
+
+namespace
+{
+	static constexpr double CalcSquare(double x)
+	{
+		return x * x;
+	}
+
+	/**
+	 * \brief	Calculates the alpha for gamma distribution. Based on
+	 * 			https://stats.stackexchange.com/questions/107679/how-to-get-only-positive-values-when-imputing-data
+	 *
+	 * \param	avg   	The average.
+	 * \param	stdDev	The standard deviation.
+	 *
+	 * \return	The calculated alpha.
+	 */
+	static constexpr double CalcAlpha(double avg, double stdDev)
+	{
+		return CalcSquare(avg / stdDev);
+	}
+
+	/**
+	 * \brief	Calculates the beta for gamma distribution. Based on
+	 * 			https://stats.stackexchange.com/questions/107679/how-to-get-only-positive-values-when-imputing-data
+	 *
+	 * \param	avg   	The average.
+	 * \param	stdDev	The standard deviation.
+	 *
+	 * \return	The calculated beta.
+	 */
+	static constexpr double CalcBeta(double avg, double stdDev)
+	{
+		return CalcSquare(stdDev) / avg;
+	}
+
+	static std::mt19937& GetRandomGenerator()
+	{
+		static thread_local std::random_device rd;
+		static thread_local std::mt19937 generator(rd());
+		return generator;
+	}
+
+	static double ParseNumber(const std::string& str, const std::string& spec)
+	{
+		size_t parsedLen = 0;
+		double res = 0.0;
+		try
+		{
+			res = std::stod(str, &parsedLen);
+		}
+		catch (const std::exception&)
+		{
+			parsedLen = 0;
+		}
+		if (parsedLen == 0 || parsedLen != str.size() || res < 0.0)
+		{
+			throw std::runtime_error("Invalid number in latency spec \"" + spec + "\".");
+		}
+		return res;
+	}
+
+	static std::vector<double> ParseNumberList(const std::string& str, const std::string& spec)
+	{
+		std::vector<double> res;
+		std::stringstream ss(str);
+		std::string item;
+		while (std::getline(ss, item, ','))
+		{
+			res.push_back(ParseNumber(item, spec));
+		}
+		return res;
+	}
+}
+
+GammaLatency::GammaLatency(double avg, double stdDev, double max) :
+	m_param(CalcAlpha(avg, stdDev), CalcBeta(avg, stdDev)),
+	m_max(max)
+{
+	if (!(avg > 0.0) || !(stdDev > 0.0) || !(max > 0.0))
+	{
+		throw std::runtime_error("The average, standard deviation and max of a gamma latency must be positive.");
+	}
+}
+
+GammaLatency::~GammaLatency()
+{
+}
+
+LatencyModel::Duration GammaLatency::Sample()
+{
+	//A new distribution object is cheap, and it keeps the sampling thread-safe.
+	std::gamma_distribution<double> dist(m_param);
+
+	double result = dist(GetRandomGenerator());
+	while (result > m_max)
+	{
+		PRINT_I("Discarded a too large sample - %f", result);
+		result = dist(GetRandomGenerator());
+	}
+
+	return Duration(result);
+}
+
+ConstantLatency::ConstantLatency(double latency) :
+	m_latency(latency)
+{
+}
+
+ConstantLatency::~ConstantLatency()
+{
+}
+
+LatencyModel::Duration ConstantLatency::Sample()
+{
+	return m_latency;
+}
+
+TraceLatency::TraceLatency(const std::string & filePath) :
+	m_trace(),
+	m_next(0)
+{
+	std::ifstream file(filePath);
+	if (!file)
+	{
+		throw std::runtime_error("Failed to open latency trace file " + filePath + ".");
+	}
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		const size_t begin = line.find_first_not_of(" \t\r");
+		if (begin == std::string::npos || line[begin] == '#')
+		{
+			continue;
+		}
+		const size_t end = line.find_last_not_of(" \t\r");
+		m_trace.push_back(ParseNumber(line.substr(begin, end - begin + 1), "trace:" + filePath));
+	}
+
+	if (m_trace.empty())
+	{
+		throw std::runtime_error("Latency trace file " + filePath + " is empty.");
+	}
+}
+
+TraceLatency::~TraceLatency()
+{
+}
+
+LatencyModel::Duration TraceLatency::Sample()
+{
+	return Duration(m_trace[m_next++ % m_trace.size()]);
+}
+
+PhasedLatency::PhasedLatency(std::vector<Phase> phases, bool isLoop) :
+	m_phases(std::move(phases)),
+	m_cycleLength(std::chrono::steady_clock::duration::zero()),
+	m_isLoop(isLoop),
+	m_start(std::chrono::steady_clock::now())
+{
+	if (m_phases.empty())
+	{
+		throw std::runtime_error("A phased latency model needs at least one phase.");
+	}
+	for (const Phase& phase : m_phases)
+	{
+		m_cycleLength += phase.m_length;
+	}
+	if (m_isLoop && m_cycleLength <= std::chrono::steady_clock::duration::zero())
+	{
+		throw std::runtime_error("A looped phased latency model must not have zero length.");
+	}
+}
+
+PhasedLatency::~PhasedLatency()
+{
+}
+
+LatencyModel::Duration PhasedLatency::Sample()
+{
+	return m_phases[GetCurrentPhase()].m_model->Sample();
+}
+
+size_t PhasedLatency::GetCurrentPhase() const
+{
+	auto elapsed = std::chrono::steady_clock::now() - m_start;
+	if (m_isLoop)
+	{
+		elapsed %= m_cycleLength;
+	}
+
+	for (size_t i = 0; i < m_phases.size(); ++i)
+	{
+		if (elapsed < m_phases[i].m_length)
+		{
+			return i;
+		}
+		elapsed -= m_phases[i].m_length;
+	}
+	return m_phases.size() - 1;
+}
+
+std::shared_ptr<LatencyModel> IasSim::ParseLatencySpec(const std::string & spec)
+{
+	const size_t sepPos = spec.find(':');
+	const std::string type = spec.substr(0, sepPos);
+	const std::string args = sepPos == std::string::npos ? std::string() : spec.substr(sepPos + 1);
+
+	if (type == "zero")
+	{
+		return std::make_shared<ConstantLatency>(0.0);
+	}
+	else if (type == "const")
+	{
+		return std::make_shared<ConstantLatency>(ParseNumber(args, spec));
+	}
+	else if (type == "gamma")
+	{
+		std::vector<double> params = ParseNumberList(args, spec);
+		if (params.size() != 2 && params.size() != 3)
+		{
+			throw std::runtime_error("Gamma latency spec \"" + spec + "\" needs an average, a standard deviation and an optional max.");
+		}
+		return std::make_shared<GammaLatency>(params[0], params[1], params.size() == 3 ? params[2] : 10000.00);
+	}
+	else if (type == "trace")
+	{
+		return std::make_shared<TraceLatency>(args);
+	}
+
+	throw std::runtime_error("Unknown latency spec \"" + spec + "\".");
+}
+
+std::shared_ptr<LatencyModel> IasSim::ParseLatencyJson(const Json::Value & json)
+{
+	if (json.isString())
+	{
+		return ParseLatencySpec(json.asString());
+	}
+
+	if (!json.isObject() || !json["Phases"].isArray() || json["Phases"].empty())
+	{
+		throw std::runtime_error("A latency model must be a spec string, or an object with a non-empty \"Phases\" array.");
+	}
+
+	std::vector<PhasedLatency::Phase> phases;
+	for (const Json::Value& phaseJson : json["Phases"])
+	{
+		if (!phaseJson.isObject() || !phaseJson["Duration"].isNumeric() || phaseJson["Duration"].asDouble() < 0.0)
+		{
+			throw std::runtime_error("Each latency phase needs a non-negative \"Duration\" in seconds.");
+		}
+
+		PhasedLatency::Phase phase;
+		phase.m_length = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double>(phaseJson["Duration"].asDouble()));
+		phase.m_model = ParseLatencyJson(phaseJson["Latency"]);
+		phases.push_back(std::move(phase));
+	}
+
+	const bool isLoop = json.isMember("Loop") ? json["Loop"].asBool() : false;
+
+	return std::make_shared<PhasedLatency>(std::move(phases), isLoop);
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace Json
+{
+	class Value;
+}
+
+namespace Decent
+{
+	namespace IasSim
+	{
+		/** \brief	A model of how long a simulated IAS call takes. Sample may be called concurrently. */
+		class LatencyModel
+		{
+		public:
+			typedef std::chrono::duration<double, std::milli> Duration;
+
+		public:
+			LatencyModel() = default;
+
+			virtual ~LatencyModel() {}
+
+			virtual Duration Sample() = 0;
+		};
+
+		/** \brief	Samples from a gamma distribution, so that the latency is always positive. */
+		class GammaLatency : public LatencyModel
+		{
+		public:
+			/**
+			 * \brief	Constructor
+			 *
+			 * \param	avg   	The average, in milliseconds.
+			 * \param	stdDev	The standard deviation, in milliseconds.
+			 * \param	max   	Samples larger than this are discarded, in milliseconds.
+			 */
+			GammaLatency(double avg, double stdDev, double max);
+
+			virtual ~GammaLatency();
+
+			virtual Duration Sample() override;
+
+		private:
+			std::gamma_distribution<double>::param_type m_param;
+			double m_max;
+		};
+
+		class ConstantLatency : public LatencyModel
+		{
+		public:
+			ConstantLatency(double latency);
+
+			virtual ~ConstantLatency();
+
+			virtual Duration Sample() override;
+
+		private:
+			Duration m_latency;
+		};
+
+		/**
+		 * \brief	Replays latencies recorded in a trace file, one value (in milliseconds) per line.
+		 * 			Empty lines and lines starting with '#' are skipped. The trace is replayed in a loop.
+		 */
+		class TraceLatency : public LatencyModel
+		{
+		public:
+			TraceLatency(const std::string& filePath);
+
+			virtual ~TraceLatency();
+
+			virtual Duration Sample() override;
+
+		private:
+			std::vector<double> m_trace;
+			std::atomic<size_t> m_next;
+		};
+
+		/**
+		 * \brief	Switches between latency models over time (e.g. to simulate a degradation spike). Each
+		 * 			phase lasts for a given time, counting from the construction of this model.
+		 */
+		class PhasedLatency : public LatencyModel
+		{
+		public:
+			struct Phase
+			{
+				std::chrono::steady_clock::duration m_length;
+				std::shared_ptr<LatencyModel> m_model;
+			};
+
+		public:
+			/**
+			 * \brief	Constructor
+			 *
+			 * \param	phases	The phases, in order. Must not be empty.
+			 * \param	isLoop	True to start over after the last phase, otherwise the last phase lasts forever.
+			 */
+			PhasedLatency(std::vector<Phase> phases, bool isLoop);
+
+			virtual ~PhasedLatency();
+
+			virtual Duration Sample() override;
+
+			/**
+			 * \brief	Gets index of the phase that is currently active.
+			 *
+			 * \return	The phase index.
+			 */
+			size_t GetCurrentPhase() const;
+
+		private:
+			std::vector<Phase> m_phases;
+			std::chrono::steady_clock::duration m_cycleLength;
+			bool m_isLoop;
+			std::chrono::steady_clock::time_point m_start;
+		};
+
+		/**
+		 * \brief	Constructs a latency model from a spec string. Supported specs are
+		 * 			"gamma:AVG,STDDEV[,MAX]", "const:MS", "zero", and "trace:FILE_PATH",
+		 * 			where all numbers are in milliseconds.
+		 *
+		 * \exception	std::runtime_error	Thrown if the spec is invalid.
+		 *
+		 * \param	spec	The spec.
+		 *
+		 * \return	The latency model.
+		 */
+		std::shared_ptr<LatencyModel> ParseLatencySpec(const std::string& spec);
+
+		/**
+		 * \brief	Constructs a latency model from JSON. It's either a spec string (see
+		 * 			ParseLatencySpec), or an object like
+		 * 			{"Phases" : [{"Duration" : SECONDS, "Latency" : SPEC_OR_OBJECT}, ...], "Loop" : true}.
+		 *
+		 * \exception	std::runtime_error	Thrown if the JSON is invalid.
+		 *
+		 * \param	json	The JSON value.
+		 *
+		 * \return	The latency model.
+		 */
+		std::shared_ptr<LatencyModel> ParseLatencyJson(const Json::Value& json);
+	}
+}
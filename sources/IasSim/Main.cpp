@@ -1,7 +1,11 @@
 #include <string>
 #include <memory>
+#include <chrono>
 #include <iostream>
 
+#include <tclap/CmdLine.h>
+#include <json/json.h>
+
 #include <DecentApi/Common/Common.h>
 #include <DecentApi/Common/Net/ConnectionPoolBase.h>
 
@@ -9,11 +13,17 @@
 #include <DecentApi/CommonApp/Net/TCPServer.h>
 #include <DecentApi/CommonApp/Net/SmartServer.h>
 #include <DecentApi/CommonApp/Threading/MainThreadAsynWorker.h>
+#include <DecentApi/CommonApp/Tools/DiskFile.h>
 
 #include "IasSimApp.h"
+#include "LatencyModel.h"
+#include "FaultModel.h"
+#include "ReportSigner.h"
+
+#include "../CommonApp/Tracer.h"
 
 #define DECENT_IAS_SIM_VERSION_MAIN 0
-#define DECENT_IAS_SIM_VERSION_SUB  5
+#define DECENT_IAS_SIM_VERSION_SUB  9
 
 #define QUOTE(str) #str
 #define EXPAND_AND_QUOTE(str) QUOTE(str)
@@ -32,6 +42,24 @@ static std::shared_ptr<ConnectionPoolBase> GetIasSimConnectionPool()
 	return tcpConnectionPool;
 }
 
+static Json::Value ReadProfileFile(const std::string& path)
+{
+	std::string jsonStr;
+	DiskFile file(path, FileBase::Mode::Read, true);
+	jsonStr.resize(file.GetFileSize());
+	file.ReadBlockExactSize(jsonStr);
+
+	Json::CharReaderBuilder builder;
+	std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+	Json::Value root;
+	std::string errMsg;
+	if (!reader->parse(jsonStr.data(), jsonStr.data() + jsonStr.size(), &root, &errMsg) || !root.isObject())
+	{
+		throw std::runtime_error("Invalid latency profile. " + errMsg);
+	}
+	return root;
+}
+
 /**
  * \brief	Main entry-point for this application
  *
@@ -50,11 +78,103 @@ int main(int argc, char ** argv)
 	//------- Setup Smart Server:
 	Net::SmartServer smartServer(mainThreadWorker);
 
+	TCLAP::CmdLine cmd("IAS Simulator", ' ', DECENT_IAS_SIM_VERSION_STR_W_PREFIX, true);
+
+	TCLAP::ValueArg<std::string> addrArg("a", "addr", "Address to listen on.", false, "127.0.0.1", "String");
+	TCLAP::ValueArg<uint16_t> portArg("p", "port", "Port to listen on.", false, 57720, "Integer");
+	TCLAP::ValueArg<size_t> workerArg("w", "workers", "Number of threads reading requests.", false, 4, "Integer");
+	TCLAP::ValueArg<size_t> dispatcherArg("d", "dispatchers", "Number of threads sending responses.", false, 2, "Integer");
+	TCLAP::ValueArg<std::string> sigRlLatencyArg("s", "sigrl-latency",
+		"Latency of SigRL requests: gamma:AVG,STDDEV[,MAX] | const:MS | zero | trace:FILE_PATH.", false, "gamma:39.00,23.79", "String");
+	TCLAP::ValueArg<std::string> reportLatencyArg("r", "report-latency",
+		"Latency of report requests, in the same format as --sigrl-latency.", false, "gamma:255.43,70.00", "String");
+	TCLAP::ValueArg<std::string> profileArg("f", "profile",
+		"Path to a JSON latency profile, with optional \"SigRl\" and \"Report\" entries, which override the latency arguments. "
+		"An entry can be a latency spec, or {\"Phases\" : [{\"Duration\" : SECONDS, \"Latency\" : ...}, ...], \"Loop\" : BOOL}. "
+		"An optional \"Faults\" entry models rate limits, limited capacity, errors and drops, in phases in the same way.",
+		false, "", "String");
+	TCLAP::ValueArg<std::string> traceArg("t", "trace",
+		"Path to a Chrome trace-event file to append spans of every request to; the Decent Server's trace file can be "
+		"given to put both on one timeline.", false, "", "String");
+	TCLAP::ValueArg<std::string> testCaArg("c", "test-ca",
+		"Path to the PEM certificate of a test CA (with its key in the same path plus \".key\"), which is generated if it "
+		"doesn't exist. If it's given, a report is built from the quote and nonce of each request and signed under this CA, "
+		"instead of sending a canned report. Simulator only: Decent Server only trusts Intel's root and has no setting to trust "
+		"this CA, so it rejects every report signed this way; use it with clients that check reports against this CA.", false, "", "String");
+	cmd.add(addrArg);
+	cmd.add(portArg);
+	cmd.add(workerArg);
+	cmd.add(dispatcherArg);
+	cmd.add(sigRlLatencyArg);
+	cmd.add(reportLatencyArg);
+	cmd.add(profileArg);
+	cmd.add(traceArg);
+	cmd.add(testCaArg);
+
+	cmd.parse(argc, argv);
+
+	//------- Setup latency and fault models:
+	std::shared_ptr<LatencyModel> sigRlLatency;
+	std::shared_ptr<LatencyModel> reportLatency;
+	std::shared_ptr<FaultModel> faults;
+	try
+	{
+		Json::Value profile;
+		if (profileArg.getValue().size() > 0)
+		{
+			profile = ReadProfileFile(profileArg.getValue());
+		}
+
+		sigRlLatency = profile.isMember("SigRl") ?
+			ParseLatencyJson(profile["SigRl"]) : ParseLatencySpec(sigRlLatencyArg.getValue());
+		reportLatency = profile.isMember("Report") ?
+			ParseLatencyJson(profile["Report"]) : ParseLatencySpec(reportLatencyArg.getValue());
+		faults = profile.isMember("Faults") ?
+			ParseFaultJson(profile["Faults"]) : std::make_shared<FaultModel>();
+	}
+	catch (const std::exception& e)
+	{
+		PRINT_W("Failed to setup latency and fault models. Error Msg: %s", e.what());
+		return -1;
+	}
+
+	//------- Setup tracing:
+	if (traceArg.getValue().size() > 0)
+	{
+		try
+		{
+			Perf::Tracer::GetInstance().Start(traceArg.getValue(), "IasSimulator", Perf::Tracer::sk_defBufferSize,
+				std::chrono::milliseconds(1000));
+		}
+		catch (const std::exception& e)
+		{
+			PRINT_W("Failed to start tracing. Error Msg: %s", e.what());
+			return -1;
+		}
+	}
+
+	//------- Setup report signer:
+	std::shared_ptr<const ReportSigner> reportSigner;
+	if (testCaArg.getValue().size() > 0)
+	{
+		try
+		{
+			reportSigner = std::make_shared<ReportSigner>(testCaArg.getValue());
+			PRINT_I("Reports are signed under the test CA in %s.", testCaArg.getValue().c_str());
+			PRINT_W("Decent Server doesn't trust the test CA, so it will reject these reports.");
+		}
+		catch (const std::exception& e)
+		{
+			PRINT_W("Failed to setup the report signer. Error Msg: %s", e.what());
+			return -1;
+		}
+	}
+
 	//------- Setup TCP server:
 	std::unique_ptr<Net::Server> tcpServer;
 	try
 	{
-		tcpServer = std::make_unique<Net::TCPServer>("127.0.0.1", 57720);
+		tcpServer = std::make_unique<Net::TCPServer>(addrArg.getValue(), portArg.getValue());
 	}
 	catch (const std::exception& e)
 	{
@@ -71,7 +191,7 @@ int main(int argc, char ** argv)
 	std::shared_ptr<IasSimApp> iasSimApp;
 	try
 	{
-		iasSimApp = std::make_shared<IasSimApp>();
+		iasSimApp = std::make_shared<IasSimApp>(sigRlLatency, reportLatency, faults, dispatcherArg.getValue(), reportSigner);
 	}
 	catch (const std::exception& e)
 	{
@@ -80,13 +200,36 @@ int main(int argc, char ** argv)
 	}
 
 	//------- Add servers to smart server.
-	smartServer.AddServer(tcpServer, iasSimApp, GetIasSimConnectionPool(), 50, 1000);
+	//Workers only read requests now; responses are sent by the simulator's dispatcher threads.
+	smartServer.AddServer(tcpServer, iasSimApp, GetIasSimConnectionPool(), workerArg.getValue(), 1000);
+
+	//------- Connect the release channel, once the server is taking connections:
+	try
+	{
+		const std::string releaseAddr = addrArg.getValue() == "0.0.0.0" ? "127.0.0.1" : addrArg.getValue();
+		iasSimApp->ConnectReleaseChannel(TCPConnection::GetIpAddressFromStr(releaseAddr), portArg.getValue());
+	}
+	catch (const std::exception& e)
+	{
+		PRINT_W("Failed to connect the release channel. Error Msg: %s", e.what());
+		iasSimApp->Terminate();
+		smartServer.Terminate();
+		return -1;
+	}
 
 	//------- keep running until an interrupt signal (Ctrl + C) is received.
 	mainThreadWorker->UpdateUntilInterrupt();
 
 	//------- Exit...
+	iasSimApp->Terminate();
 	smartServer.Terminate();
+	Perf::Tracer::GetInstance().Stop();
+
+	iasSimApp->GetFaultModel().PrintStats();
+	if (reportSigner)
+	{
+		PRINT_I("Invalid report requests: %llu.", static_cast<unsigned long long>(iasSimApp->GetInvalidCount()));
+	}
 
 	PRINT_I("Exit ...\n");
 	return 0;
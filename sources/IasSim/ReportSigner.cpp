@@ -0,0 +1,388 @@
+#include "ReportSigner.h"
+
+#include <ctime>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cstdio>
+#include <stdexcept>
+
+#include <json/json.h>
+
+#include <mbedtls/pk.h>
+#include <mbedtls/md.h>
+#include <mbedtls/rsa.h>
+#include <mbedtls/bignum.h>
+#include <mbedtls/base64.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/x509_crt.h>
+
+#include <DecentApi/CommonApp/Tools/DiskFile.h>
+
+#ifndef _WIN32
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/stat.h>
+#endif // !_WIN32
+
+using namespace Decent;
+using namespace Decent::IasSim;
+using namespace Decent::Tools;
+
+constexpr size_t ReportSigner::sk_quoteBodySize;
+
+namespace
+{
+	static constexpr char gsk_caName[] = "CN=Decent IAS Simulator Test CA,O=Decent,C=US";
+	static constexpr char gsk_signerName[] = "CN=Decent IAS Simulator Report Signing,O=Decent,C=US";
+	static constexpr char gsk_rngPers[] = "DecentIasSim";
+
+	static constexpr unsigned int gsk_rsaBits = 2048;
+	static constexpr int gsk_rsaExp = 65537;
+
+	/** \brief	Length of the base64 encoding of the quote body; the body is a multiple of 3 bytes, so it has no padding. */
+	static constexpr size_t gsk_quoteBodyB64Size = ReportSigner::sk_quoteBodySize / 3 * 4;
+
+	/** \brief	IAS rejects nonces longer than this. */
+	static constexpr size_t gsk_maxNonceSize = 32;
+
+	static std::atomic<uint64_t> gs_nextSignerId(1);
+
+	static void CheckMbedTls(int ret, const char* what)
+	{
+		if (ret != 0)
+		{
+			throw std::runtime_error(std::string("Failed to ") + what + ". mbedTLS error: " + std::to_string(ret) + ".");
+		}
+	}
+
+	struct Rng
+	{
+		Rng()
+		{
+			mbedtls_entropy_init(&m_entropy);
+			mbedtls_ctr_drbg_init(&m_drbg);
+			const int ret = mbedtls_ctr_drbg_seed(&m_drbg, &mbedtls_entropy_func, &m_entropy,
+				reinterpret_cast<const unsigned char*>(gsk_rngPers), sizeof(gsk_rngPers) - 1);
+			if (ret != 0)
+			{
+				mbedtls_ctr_drbg_free(&m_drbg);
+				mbedtls_entropy_free(&m_entropy);
+				CheckMbedTls(ret, "seed the RNG");
+			}
+		}
+
+		~Rng()
+		{
+			mbedtls_ctr_drbg_free(&m_drbg);
+			mbedtls_entropy_free(&m_entropy);
+		}
+
+		mbedtls_entropy_context m_entropy;
+		mbedtls_ctr_drbg_context m_drbg;
+	};
+
+	struct PkKey
+	{
+		PkKey()
+		{
+			mbedtls_pk_init(&m_ctx);
+		}
+
+		~PkKey()
+		{
+			mbedtls_pk_free(&m_ctx);
+		}
+
+		mbedtls_pk_context m_ctx;
+	};
+
+	struct X509Cert
+	{
+		X509Cert()
+		{
+			mbedtls_x509_crt_init(&m_ctx);
+		}
+
+		~X509Cert()
+		{
+			mbedtls_x509_crt_free(&m_ctx);
+		}
+
+		mbedtls_x509_crt m_ctx;
+	};
+
+	static void GenerateKey(PkKey& key, Rng& rng)
+	{
+		CheckMbedTls(mbedtls_pk_setup(&key.m_ctx, mbedtls_pk_info_from_type(MBEDTLS_PK_RSA)), "set up a key");
+		CheckMbedTls(mbedtls_rsa_gen_key(mbedtls_pk_rsa(key.m_ctx), &mbedtls_ctr_drbg_random, &rng.m_drbg, gsk_rsaBits, gsk_rsaExp),
+			"generate an RSA key");
+	}
+
+	static void ParseKey(PkKey& key, const std::string& pem)
+	{
+		//PEM input has to include the null terminator.
+		CheckMbedTls(mbedtls_pk_parse_key(&key.m_ctx, reinterpret_cast<const unsigned char*>(pem.c_str()), pem.size() + 1, nullptr, 0),
+			"parse the key");
+	}
+
+	static std::string WriteKeyPem(PkKey& key)
+	{
+		std::vector<unsigned char> buf(8192);
+		CheckMbedTls(mbedtls_pk_write_key_pem(&key.m_ctx, buf.data(), buf.size()), "write the key");
+		return std::string(reinterpret_cast<const char*>(buf.data()));
+	}
+
+	static std::string IssueCert(PkKey& subjectKey, const char* subjectName, PkKey& issuerKey, const char* issuerName,
+		int64_t serialNum, bool isCa, Rng& rng)
+	{
+		mbedtls_x509write_cert crt;
+		mbedtls_mpi serial;
+		mbedtls_x509write_crt_init(&crt);
+		mbedtls_mpi_init(&serial);
+
+		std::vector<unsigned char> buf(8192);
+		mbedtls_x509write_crt_set_version(&crt, MBEDTLS_X509_CRT_VERSION_3);
+		mbedtls_x509write_crt_set_md_alg(&crt, MBEDTLS_MD_SHA256);
+		mbedtls_x509write_crt_set_subject_key(&crt, &subjectKey.m_ctx);
+		mbedtls_x509write_crt_set_issuer_key(&crt, &issuerKey.m_ctx);
+		const int ret = (mbedtls_x509write_crt_set_subject_name(&crt, subjectName) != 0 ||
+			mbedtls_x509write_crt_set_issuer_name(&crt, issuerName) != 0 ||
+			mbedtls_mpi_lset(&serial, serialNum) != 0 ||
+			mbedtls_x509write_crt_set_serial(&crt, &serial) != 0 ||
+			mbedtls_x509write_crt_set_validity(&crt, "20190101000000", "20491231235959") != 0 ||
+			mbedtls_x509write_crt_set_basic_constraints(&crt, isCa ? 1 : 0, isCa ? 0 : -1) != 0 ||
+			mbedtls_x509write_crt_set_key_usage(&crt, isCa ?
+				(MBEDTLS_X509_KU_KEY_CERT_SIGN | MBEDTLS_X509_KU_CRL_SIGN) :
+				(MBEDTLS_X509_KU_DIGITAL_SIGNATURE | MBEDTLS_X509_KU_NON_REPUDIATION)) != 0) ?
+			-1 : mbedtls_x509write_crt_pem(&crt, buf.data(), buf.size(), &mbedtls_ctr_drbg_random, &rng.m_drbg);
+
+		mbedtls_mpi_free(&serial);
+		mbedtls_x509write_crt_free(&crt);
+
+		CheckMbedTls(ret, "issue a certificate");
+		return std::string(reinterpret_cast<const char*>(buf.data()));
+	}
+
+	static bool IsFileExist(const std::string& path)
+	{
+		std::FILE* file = std::fopen(path.c_str(), "rb");
+		if (file == nullptr)
+		{
+			return false;
+		}
+		std::fclose(file);
+		return true;
+	}
+
+	static std::string ReadTextFile(const std::string& path)
+	{
+		std::string res;
+		DiskFile file(path, FileBase::Mode::Read, true);
+		res.resize(file.GetFileSize());
+		file.ReadBlockExactSize(res);
+		return res;
+	}
+
+	static void WriteTextFile(const std::string& path, const std::string& content)
+	{
+		DiskFile file(path, FileBase::Mode::Write, true);
+		file.WriteBlockExactSize(content);
+	}
+
+	/** \brief	Writes a new file readable only by its owner (on POSIX), e.g. for a private key. */
+	static void WritePrivateFile(const std::string& path, const std::string& content)
+	{
+#ifdef _WIN32
+		WriteTextFile(path, content);
+#else
+		//Created with the mode set, so the content is never readable by others, not even briefly.
+		const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+		if (fd < 0)
+		{
+			throw std::runtime_error("Failed to create file " + path + ".");
+		}
+		//An existing file keeps its mode, so it's set again.
+		bool isWritten = fchmod(fd, S_IRUSR | S_IWUSR) == 0;
+		for (size_t pos = 0; isWritten && pos < content.size();)
+		{
+			const ssize_t len = write(fd, content.data() + pos, content.size() - pos);
+			isWritten = len > 0;
+			pos += isWritten ? static_cast<size_t>(len) : 0;
+		}
+		isWritten = close(fd) == 0 && isWritten;
+		if (!isWritten)
+		{
+			throw std::runtime_error("Failed to write file " + path + ".");
+		}
+#endif // _WIN32
+	}
+
+	static bool IsBase64Char(char ch)
+	{
+		return (ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9') || ch == '+' || ch == '/';
+	}
+
+	/** \brief	Gets the current time in the format of IAS reports, e.g. 2019-06-21T22:48:29.863997 (UTC). */
+	static std::string GetTimestamp()
+	{
+		using namespace std::chrono;
+		const system_clock::time_point now = system_clock::now();
+		const std::time_t sec = system_clock::to_time_t(now);
+		const long long us = duration_cast<microseconds>(now.time_since_epoch()).count() % 1000000;
+
+		std::tm utc;
+#ifdef _WIN32
+		gmtime_s(&utc, &sec);
+#else
+		gmtime_r(&sec, &utc);
+#endif // _WIN32
+
+		char buf[40];
+		const size_t len = std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &utc);
+		std::snprintf(buf + len, sizeof(buf) - len, ".%06lld", us);
+		return buf;
+	}
+}
+
+struct Decent::IasSim::SignerContext
+{
+	SignerContext(uint64_t signerId, const std::string& keyPem) :
+		m_signerId(signerId),
+		m_rng(),
+		m_key()
+	{
+		ParseKey(m_key, keyPem);
+	}
+
+	const uint64_t m_signerId;
+	Rng m_rng;
+	PkKey m_key;
+};
+
+ReportSigner::ReportSigner(const std::string & caCertPath) :
+	m_caCert(),
+	m_signKey(),
+	m_certChain(),
+	m_signerId(gs_nextSignerId.fetch_add(1)),
+	m_nextReportId(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count()))
+{
+	Rng rng;
+	PkKey caKey;
+	std::string caName = gsk_caName;
+
+	const std::string caKeyPath = caCertPath + ".key";
+	if (IsFileExist(caCertPath))
+	{
+		m_caCert = ReadTextFile(caCertPath);
+		ParseKey(caKey, ReadTextFile(caKeyPath));
+
+		X509Cert caCert;
+		CheckMbedTls(mbedtls_x509_crt_parse(&caCert.m_ctx, reinterpret_cast<const unsigned char*>(m_caCert.c_str()), m_caCert.size() + 1),
+			"parse the CA certificate");
+		CheckMbedTls(mbedtls_pk_check_pair(&caCert.m_ctx.pk, &caKey.m_ctx), "match the CA certificate with its key");
+
+		//Issue under the name in the certificate, in case it's not one generated here.
+		char nameBuf[512];
+		if (mbedtls_x509_dn_gets(nameBuf, sizeof(nameBuf), &caCert.m_ctx.subject) < 0)
+		{
+			throw std::runtime_error("Failed to read the name of the CA.");
+		}
+		caName = nameBuf;
+	}
+	else
+	{
+		GenerateKey(caKey, rng);
+		m_caCert = IssueCert(caKey, gsk_caName, caKey, gsk_caName, 1, true, rng);
+
+		WritePrivateFile(caKeyPath, WriteKeyPem(caKey));
+		WriteTextFile(caCertPath, m_caCert);
+	}
+
+	//The signing key is only kept for this run; only the root has to be trusted.
+	PkKey signKey;
+	GenerateKey(signKey, rng);
+	m_signKey = WriteKeyPem(signKey);
+	m_certChain = IssueCert(signKey, gsk_signerName, caKey, caName.c_str(), 2, false, rng) + m_caCert;
+}
+
+ReportSigner::~ReportSigner()
+{
+}
+
+void ReportSigner::Sign(const std::string & reqStr, std::string & report, std::string & signature) const
+{
+	Json::CharReaderBuilder builder;
+	std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+	Json::Value req;
+	std::string errMsg;
+	if (!reader->parse(reqStr.data(), reqStr.data() + reqStr.size(), &req, &errMsg) || !req.isObject() ||
+		!req.isMember("isvEnclaveQuote") || !req["isvEnclaveQuote"].isString())
+	{
+		throw std::invalid_argument("Invalid report request. " + errMsg);
+	}
+
+	//The body is copied as-is from the quote's encoding, so it doesn't have to be decoded.
+	const std::string quote = req["isvEnclaveQuote"].asString();
+	if (quote.size() <= gsk_quoteBodyB64Size || quote.size() % 4 != 0)
+	{
+		throw std::invalid_argument("Invalid quote size.");
+	}
+	for (size_t i = 0; i < gsk_quoteBodyB64Size; ++i)
+	{
+		if (!IsBase64Char(quote[i]))
+		{
+			throw std::invalid_argument("Invalid quote encoding.");
+		}
+	}
+
+	const bool hasNonce = req.isMember("nonce");
+	if (hasNonce && (!req["nonce"].isString() || req["nonce"].asString().size() > gsk_maxNonceSize))
+	{
+		throw std::invalid_argument("Invalid nonce.");
+	}
+
+	report.clear();
+	report.reserve(gsk_quoteBodyB64Size + 256);
+	report += '{';
+	if (hasNonce)
+	{
+		report += "\"nonce\":" + Json::valueToQuotedString(req["nonce"].asCString()) + ',';
+	}
+	report += "\"id\":\"" + std::to_string(m_nextReportId.fetch_add(1, std::memory_order_relaxed)) + '\"';
+	report += ",\"timestamp\":\"" + GetTimestamp() + '\"';
+	report += ",\"version\":3,\"isvEnclaveQuoteStatus\":\"OK\",\"isvEnclaveQuoteBody\":\"";
+	report.append(quote, 0, gsk_quoteBodyB64Size);
+	report += "\"}";
+
+	//Signed as IAS does, i.e. RSA PKCS#1 v1.5 with SHA-256.
+	SignerContext& ctx = GetThreadContext();
+	std::array<unsigned char, 32> hash;
+	CheckMbedTls(mbedtls_md(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), reinterpret_cast<const unsigned char*>(report.data()),
+		report.size(), hash.data()), "hash the report");
+
+	std::array<unsigned char, MBEDTLS_MPI_MAX_SIZE> sign;
+	size_t signSize = 0;
+	CheckMbedTls(mbedtls_pk_sign(&ctx.m_key.m_ctx, MBEDTLS_MD_SHA256, hash.data(), hash.size(), sign.data(), &signSize,
+		&mbedtls_ctr_drbg_random, &ctx.m_rng.m_drbg), "sign the report");
+
+	size_t b64Size = 0;
+	signature.resize((signSize + 2) / 3 * 4 + 1);
+	CheckMbedTls(mbedtls_base64_encode(reinterpret_cast<unsigned char*>(&signature[0]), signature.size(), &b64Size,
+		sign.data(), signSize), "encode the signature");
+	signature.resize(b64Size);
+}
+
+SignerContext & ReportSigner::GetThreadContext() const
+{
+	//mbedTLS contexts are not thread-safe, and RSA blinding updates the key's context on every signature.
+	thread_local std::unique_ptr<SignerContext> tl_ctx;
+	if (!tl_ctx || tl_ctx->m_signerId != m_signerId)
+	{
+		tl_ctx = std::make_unique<SignerContext>(m_signerId, m_signKey);
+	}
+	return *tl_ctx;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+namespace Decent
+{
+	namespace IasSim
+	{
+		struct SignerContext;
+
+		/**
+		 * \brief	Builds attestation reports from the submitted quote and nonce, the way IAS does, and
+		 * 			signs them with a test CA of the simulator's own, so the verifier can check that the
+		 * 			report matches what was sent (instead of accepting the same canned report every time).
+		 *
+		 * 			The report signing certificate is issued by a self-signed root CA, which is loaded
+		 * 			from the given file, or generated and saved there on the first run (the key readable
+		 * 			only by its owner). It's for clients that check reports against this root, and for
+		 * 			load testing the simulator (e.g. with LoadGen), not for a real server: Decent Server
+		 * 			verifies reports against Intel's root built into DecentApi, and has no setting to
+		 * 			trust another root, so it rejects every report signed this way. Reports are built
+		 * 			by string concatenation and signed with RSA-2048 (as IAS does); each thread signs
+		 * 			with its own copy of the key, so signing scales with the number of threads calling
+		 * 			it.
+		 */
+		class ReportSigner
+		{
+		public:
+			/** \brief	Size of the quote body in a report, i.e. sgx_quote_t without the signature. */
+			static constexpr size_t sk_quoteBodySize = 432;
+
+		public:
+			/**
+			 * \brief	Constructor
+			 *
+			 * \exception	std::runtime_error	Thrown if the CA files exist but can't be parsed, or keys or
+			 * 									certificates can't be generated.
+			 *
+			 * \param	caCertPath	Path to the PEM file of the root CA's certificate; its key is kept in
+			 * 						the same path with ".key" appended. Both are generated if the
+			 * 						certificate doesn't exist.
+			 */
+			ReportSigner(const std::string& caCertPath);
+
+			ReportSigner(const ReportSigner& rhs) = delete;
+
+			virtual ~ReportSigner();
+
+			/**
+			 * \brief	Builds and signs a report for a report request.
+			 *
+			 * \exception	std::invalid_argument	Thrown if the request is not a valid report request
+			 * 										(i.e. IAS would answer it with 400).
+			 * \exception	std::runtime_error   	Thrown if signing fails.
+			 *
+			 * \param 		  	reqStr   	The request body, i.e. JSON with "isvEnclaveQuote", and an
+			 * 								optional "nonce".
+			 * \param [out]	report   	The report.
+			 * \param [out]	signature	The base64-encoded signature of the report.
+			 */
+			void Sign(const std::string& reqStr, std::string& report, std::string& signature) const;
+
+			/** \brief	Gets the certificate chain sent with every report, i.e. the signing certificate then the root's. */
+			const std::string& GetCertChain() const noexcept { return m_certChain; }
+
+			const std::string& GetCaCert() const noexcept { return m_caCert; }
+
+		private:
+			/** \brief	Gets the calling thread's signing context, setting it up on the first call. */
+			SignerContext& GetThreadContext() const;
+
+			std::string m_caCert;
+			std::string m_signKey;
+			std::string m_certChain;
+
+			/** \brief	Identifies this signer in the threads' contexts, so a new signer isn't served stale keys. */
+			const uint64_t m_signerId;
+
+			mutable std::atomic<uint64_t> m_nextReportId;
+		};
+	}
+}
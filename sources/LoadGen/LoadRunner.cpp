@@ -0,0 +1,200 @@
+#include "LoadRunner.h"
+
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <condition_variable>
+
+using namespace Decent;
+using namespace Decent::LoadGen;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	//Arrivals beyond this many per client are dropped, so the backlog can't grow without bound.
+	static constexpr size_t gsk_maxBacklogPerClient = 1000;
+
+	static uint64_t ToMicroseconds(Clock::duration d)
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+	}
+
+	/**
+	 * \brief	Runs a request, and records its result if it has started after the warm up.
+	 *
+	 * \param	request 	The request.
+	 * \param	start   	The time the request started (or should have started).
+	 * \param	warmUpEnd	The time the warm up ends.
+	 * \param	result   	The result.
+	 * \param	errorCount	The error counter.
+	 */
+	static void RunOne(const LoadRunner::Request& request, Clock::time_point start, Clock::time_point warmUpEnd,
+		LoadResult& result, std::atomic<uint64_t>& errorCount)
+	{
+		bool isSuccess = true;
+		try
+		{
+			request();
+		}
+		catch (const std::exception&)
+		{
+			isSuccess = false;
+		}
+
+		if (start < warmUpEnd)
+		{
+			return;
+		}
+
+		if (isSuccess)
+		{
+			result.m_latency.Record(ToMicroseconds(Clock::now() - start));
+		}
+		else
+		{
+			++errorCount;
+		}
+	}
+}
+
+LoadRunner::LoadRunner(const LoadConfig & config) :
+	m_config(config)
+{
+	m_config.m_clientNum = std::max<size_t>(m_config.m_clientNum, 1);
+	m_config.m_warmUp = std::min(m_config.m_warmUp, m_config.m_duration);
+}
+
+LoadRunner::~LoadRunner()
+{
+}
+
+void LoadRunner::Run(const Request & request, LoadResult & result)
+{
+	if (m_config.m_arrivalRate > 0.0)
+	{
+		RunOpenLoop(request, result);
+	}
+	else
+	{
+		RunClosedLoop(request, result);
+	}
+}
+
+void LoadRunner::RunClosedLoop(const Request & request, LoadResult & result)
+{
+	const Clock::time_point begin = Clock::now();
+	const Clock::time_point warmUpEnd = begin + std::chrono::duration_cast<Clock::duration>(m_config.m_warmUp);
+	const Clock::time_point end = begin + std::chrono::duration_cast<Clock::duration>(m_config.m_duration);
+
+	std::atomic<uint64_t> errorCount(0);
+
+	std::vector<std::thread> clients;
+	for (size_t i = 0; i < m_config.m_clientNum; ++i)
+	{
+		clients.emplace_back([&]()
+		{
+			Clock::time_point start = Clock::now();
+			while (start < end)
+			{
+				RunOne(request, start, warmUpEnd, result, errorCount);
+				start = Clock::now();
+			}
+		});
+	}
+
+	for (std::thread& client : clients)
+	{
+		client.join();
+	}
+
+	result.m_errorCount += errorCount;
+	result.m_measuredTime += std::chrono::duration<double>(std::max(Clock::now(), warmUpEnd) - warmUpEnd).count();
+}
+
+void LoadRunner::RunOpenLoop(const Request & request, LoadResult & result)
+{
+	const Clock::time_point begin = Clock::now();
+	const Clock::time_point warmUpEnd = begin + std::chrono::duration_cast<Clock::duration>(m_config.m_warmUp);
+	const Clock::time_point end = begin + std::chrono::duration_cast<Clock::duration>(m_config.m_duration);
+	const size_t maxBacklog = m_config.m_clientNum * gsk_maxBacklogPerClient;
+
+	std::atomic<uint64_t> errorCount(0);
+	uint64_t droppedCount = 0;
+
+	std::mutex queueMutex;
+	std::condition_variable queueSignal;
+	std::deque<Clock::time_point> arrivals;
+	bool isArrivalDone = false;
+
+	std::vector<std::thread> clients;
+	for (size_t i = 0; i < m_config.m_clientNum; ++i)
+	{
+		clients.emplace_back([&]()
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			while (true)
+			{
+				queueSignal.wait(lock, [&]() { return isArrivalDone || !arrivals.empty(); });
+				if (arrivals.empty())
+				{
+					return;
+				}
+
+				const Clock::time_point arrival = arrivals.front();
+				arrivals.pop_front();
+				lock.unlock();
+
+				RunOne(request, arrival, warmUpEnd, result, errorCount);
+
+				lock.lock();
+			}
+		});
+	}
+
+	std::random_device rd;
+	std::mt19937 generator(rd());
+	std::exponential_distribution<double> poissonGap(m_config.m_arrivalRate);
+	const std::chrono::duration<double> evenGap(1.0 / m_config.m_arrivalRate);
+
+	Clock::time_point nextArrival = begin;
+	while (nextArrival < end)
+	{
+		std::this_thread::sleep_until(nextArrival);
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			if (arrivals.size() < maxBacklog)
+			{
+				arrivals.push_back(nextArrival);
+			}
+			else if (nextArrival >= warmUpEnd)
+			{
+				++droppedCount;
+			}
+		}
+		queueSignal.notify_one();
+
+		const std::chrono::duration<double> gap = m_config.m_isPoisson ?
+			std::chrono::duration<double>(poissonGap(generator)) : evenGap;
+		nextArrival += std::chrono::duration_cast<Clock::duration>(gap);
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(queueMutex);
+		isArrivalDone = true;
+	}
+	queueSignal.notify_all();
+
+	for (std::thread& client : clients)
+	{
+		client.join();
+	}
+
+	result.m_errorCount += errorCount;
+	result.m_droppedCount += droppedCount;
+	//Requests still queued at the end are served and counted, so the period lasts until the last one is done.
+	result.m_measuredTime += std::chrono::duration<double>(std::max(Clock::now(), warmUpEnd) - warmUpEnd).count();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+#include "../CommonApp/LatencyHistogram.h"
+
+namespace Decent
+{
+	namespace LoadGen
+	{
+		struct LoadConfig
+		{
+			/** \brief	Number of concurrent clients (i.e. worker threads). */
+			size_t m_clientNum;
+
+			/** \brief	Arrival rate in requests per second for an open loop; zero for a closed loop. */
+			double m_arrivalRate;
+
+			/** \brief	True for Poisson arrivals in an open loop, false for evenly spaced arrivals. */
+			bool m_isPoisson;
+
+			/** \brief	Requests started before the warm up is over are not recorded. */
+			std::chrono::duration<double> m_warmUp;
+
+			/** \brief	How long to generate load for, including the warm up. */
+			std::chrono::duration<double> m_duration;
+		};
+
+		struct LoadResult
+		{
+			/** \brief	Latencies of successful requests, in microseconds. */
+			Perf::LatencyHistogram m_latency;
+
+			uint64_t m_errorCount = 0;
+
+			/** \brief	Open loop arrivals dropped because all clients were busy for too long. */
+			uint64_t m_droppedCount = 0;
+
+			/**
+			 * \brief	Length of the measured period, in seconds, from the end of the warm up until the
+			 * 			last recorded request is done.
+			 */
+			double m_measuredTime = 0.0;
+		};
+
+		/**
+		 * \brief	Runs a request function with a closed loop (each client starts its next request as
+		 * 			soon as the last one is done) or an open loop (requests arrive at a given rate).
+		 * 			In an open loop, the latency is measured from the time a request was supposed to
+		 * 			arrive, so queueing in the load generator is not hidden (i.e. no coordinated
+		 * 			omission).
+		 */
+		class LoadRunner
+		{
+		public:
+			/**
+			 * \brief	A request. It returns normally if it succeeded, or throws if it failed.
+			 */
+			typedef std::function<void()> Request;
+
+		public:
+			LoadRunner(const LoadConfig& config);
+
+			virtual ~LoadRunner();
+
+			/**
+			 * \brief	Generates load until the configured duration is over.
+			 *
+			 * \param 		  	request	The request to run.
+			 * \param [in,out]	result 	The result.
+			 */
+			void Run(const Request& request, LoadResult& result);
+
+		private:
+			void RunClosedLoop(const Request& request, LoadResult& result);
+
+			void RunOpenLoop(const Request& request, LoadResult& result);
+
+			LoadConfig m_config;
+		};
+	}
+}
@@ -0,0 +1,230 @@
+#include <string>
+#include <memory>
+#include <fstream>
+#include <iostream>
+
+#include <tclap/CmdLine.h>
+#include <json/json.h>
+
+#include <DecentApi/Common/Common.h>
+
+#include <DecentApi/CommonApp/Net/TCPConnection.h>
+#include <DecentApi/CommonApp/Net/LocalConnection.h>
+#include <DecentApi/CommonApp/Tools/DiskFile.h>
+
+#include "../CommonApp/ShmRingConnection.h"
+
+#include "LoadRunner.h"
+#include "Workload.h"
+
+#define DECENT_LOAD_GEN_VERSION_MAIN 0
+#define DECENT_LOAD_GEN_VERSION_SUB  2
+
+#define QUOTE(str) #str
+#define EXPAND_AND_QUOTE(str) QUOTE(str)
+#define DECENT_LOAD_GEN_VERSION_STR EXPAND_AND_QUOTE(DECENT_LOAD_GEN_VERSION_MAIN) "." EXPAND_AND_QUOTE(DECENT_LOAD_GEN_VERSION_SUB)
+#define DECENT_LOAD_GEN_VERSION_STR_W_PREFIX "Ver" DECENT_LOAD_GEN_VERSION_STR
+
+using namespace Decent;
+using namespace Decent::LoadGen;
+using namespace Decent::Tools;
+
+namespace
+{
+	static constexpr double gsk_reportedPercentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+	static constexpr char const* gsk_reportedPercentileNames[] = { "P50", "P90", "P99", "P999" };
+
+	static Json::Value ResultToJson(const LoadConfig& config, const std::string& workload, const LoadResult& result)
+	{
+		const Perf::LatencyHistogram& latency = result.m_latency;
+
+		Json::Value root;
+		root["Workload"] = workload;
+		root["Mode"] = config.m_arrivalRate > 0.0 ? "Open" : "Closed";
+		root["Clients"] = static_cast<Json::UInt64>(config.m_clientNum);
+		root["ArrivalRate"] = config.m_arrivalRate;
+		root["Duration"] = config.m_duration.count();
+		root["WarmUp"] = config.m_warmUp.count();
+
+		root["Completed"] = static_cast<Json::UInt64>(latency.GetCount());
+		root["Errors"] = static_cast<Json::UInt64>(result.m_errorCount);
+		root["Dropped"] = static_cast<Json::UInt64>(result.m_droppedCount);
+		root["Throughput"] = result.m_measuredTime > 0.0 ? latency.GetCount() / result.m_measuredTime : 0.0;
+
+		Json::Value& latencyJson = root["Latency"];
+		latencyJson["Unit"] = "us";
+		latencyJson["Min"] = static_cast<Json::UInt64>(latency.GetMin());
+		latencyJson["Mean"] = latency.GetMean();
+		latencyJson["Max"] = static_cast<Json::UInt64>(latency.GetMax());
+		for (size_t i = 0; i < sizeof(gsk_reportedPercentiles) / sizeof(gsk_reportedPercentiles[0]); ++i)
+		{
+			latencyJson[gsk_reportedPercentileNames[i]] = static_cast<Json::UInt64>(latency.GetPercentile(gsk_reportedPercentiles[i]));
+		}
+
+		//Non-empty buckets of the HDR histogram, as [highest equivalent value, count].
+		Json::Value& bucketsJson = latencyJson["Histogram"];
+		bucketsJson = Json::Value(Json::arrayValue);
+		for (const auto& bucket : latency.GetBuckets())
+		{
+			Json::Value item(Json::arrayValue);
+			item.append(static_cast<Json::UInt64>(bucket.first));
+			item.append(static_cast<Json::UInt64>(bucket.second));
+			bucketsJson.append(item);
+		}
+
+		return root;
+	}
+
+	static std::string ReadPayloadFile(const std::string& path)
+	{
+		std::string payload;
+		if (path.size() > 0)
+		{
+			DiskFile file(path, FileBase::Mode::Read, true);
+			payload.resize(file.GetFileSize());
+			file.ReadBlockExactSize(payload);
+		}
+		return payload;
+	}
+}
+
+/**
+ * \brief	Main entry-point for this application
+ *
+ * \param	argc	The number of command-line arguments provided.
+ * \param	argv	An array of command-line argument strings.
+ *
+ * \return	Exit-code for the process - 0 for success, else an error code.
+ */
+int main(int argc, char ** argv)
+{
+	std::cerr << "================ Decent Load Generator " DECENT_LOAD_GEN_VERSION_STR_W_PREFIX " ================" << std::endl;
+
+	TCLAP::CmdLine cmd("Decent Load Generator", ' ', DECENT_LOAD_GEN_VERSION_STR_W_PREFIX, true);
+
+	TCLAP::ValueArg<std::string> addrArg("a", "addr", "Address of the server.", false, "127.0.0.1", "String");
+	TCLAP::ValueArg<uint16_t> portArg("p", "port",
+		"Port of the server; 0 for the default of the workload, i.e. IAS Simulator's (57720) for ias-*, and the Decent Server's (57755) for the others.",
+		false, 0, "Integer");
+	TCLAP::SwitchArg localArg("l", "local", "Connect to the local server (i.e. Local_ADDR_PORT) instead of the TCP server.", false);
+	TCLAP::SwitchArg noShmArg("", "no-shm", "With --local, don't try the shared-memory transport before the local connection.", false);
+	TCLAP::ValueArg<std::string> workloadArg("w", "workload", "Workload: ias-sigrl | ias-report | ias-attestation | request.", false, "ias-report", "String");
+	TCLAP::ValueArg<std::string> categoryArg("", "category", "Smart message category of the request workload.", false, "", "String");
+	TCLAP::ValueArg<std::string> payloadArg("", "payload", "Path to a file whose content is the payload of the request workload.", false, "", "String");
+	TCLAP::ValueArg<size_t> clientArg("c", "clients", "Number of concurrent clients.", false, 16, "Integer");
+	TCLAP::ValueArg<double> rateArg("r", "rate", "Arrival rate (requests/s) of an open loop; 0 for a closed loop.", false, 0.0, "Number");
+	TCLAP::SwitchArg poissonArg("", "poisson", "Use Poisson arrivals, instead of evenly spaced arrivals, in an open loop.", false);
+	TCLAP::ValueArg<double> durationArg("d", "duration", "Test duration in seconds, including the warm up.", false, 30.0, "Number");
+	TCLAP::ValueArg<double> warmUpArg("", "warm-up", "Warm up in seconds; requests started in it are not recorded.", false, 5.0, "Number");
+	TCLAP::ValueArg<std::string> outputArg("o", "output", "Path to the JSON result file; the result is printed to stdout if not given.", false, "", "String");
+	cmd.add(addrArg);
+	cmd.add(portArg);
+	cmd.add(localArg);
+	cmd.add(noShmArg);
+	cmd.add(workloadArg);
+	cmd.add(categoryArg);
+	cmd.add(payloadArg);
+	cmd.add(clientArg);
+	cmd.add(rateArg);
+	cmd.add(poissonArg);
+	cmd.add(durationArg);
+	cmd.add(warmUpArg);
+	cmd.add(outputArg);
+
+	cmd.parse(argc, argv);
+
+	//------- Setup workload:
+	std::unique_ptr<RequestWorkload> workload;
+	try
+	{
+		workload = CreateWorkload(workloadArg.getValue(), categoryArg.getValue(), ReadPayloadFile(payloadArg.getValue()));
+	}
+	catch (const std::exception& e)
+	{
+		PRINT_W("Failed to setup the workload. Error Msg: %s", e.what());
+		return -1;
+	}
+
+	//------- Setup endpoint:
+	const uint16_t serverPort = portArg.getValue() != 0 ? portArg.getValue() : GetDefaultPort(workloadArg.getValue());
+	const std::string localServerName = "Local_" + addrArg.getValue() + "_" + std::to_string(serverPort);
+	uint32_t serverIp = 0;
+	try
+	{
+		serverIp = Net::TCPConnection::GetIpAddressFromStr(addrArg.getValue());
+	}
+	catch (const std::exception& e)
+	{
+		PRINT_W("Invalid server address. Error Msg: %s", e.what());
+		return -1;
+	}
+
+	const bool isLocal = localArg.getValue();
+	const bool isShmAllowed = !noShmArg.getValue();
+	LoadRunner::Request request = [&]()
+	{
+		std::unique_ptr<Net::ConnectionBase> connection;
+		if (isLocal && isShmAllowed)
+		{
+			connection = ShmNet::ConnectLocal(localServerName);
+		}
+		else if (isLocal)
+		{
+			connection = std::make_unique<Net::LocalConnection>(localServerName);
+		}
+		else
+		{
+			connection = std::make_unique<Net::TCPConnection>(serverIp, serverPort);
+		}
+		workload->Run(*connection);
+	};
+
+	//------- Generate load:
+	LoadConfig config;
+	config.m_clientNum = clientArg.getValue();
+	config.m_arrivalRate = rateArg.getValue();
+	config.m_isPoisson = poissonArg.getValue();
+	config.m_warmUp = std::chrono::duration<double>(warmUpArg.getValue());
+	config.m_duration = std::chrono::duration<double>(durationArg.getValue());
+
+	PRINT_I("Running workload %s against %s for %f s...", workloadArg.getValue().c_str(),
+		isLocal ? localServerName.c_str() : (addrArg.getValue() + ":" + std::to_string(serverPort)).c_str(), config.m_duration.count());
+
+	std::unique_ptr<LoadResult> result = std::make_unique<LoadResult>();
+	LoadRunner(config).Run(request, *result);
+
+	//------- Report:
+	Json::Value resultJson = ResultToJson(config, workloadArg.getValue(), *result);
+
+	PRINT_I("Completed: %llu, errors: %llu, dropped: %llu, throughput: %f/s.",
+		static_cast<unsigned long long>(result->m_latency.GetCount()),
+		static_cast<unsigned long long>(result->m_errorCount),
+		static_cast<unsigned long long>(result->m_droppedCount),
+		resultJson["Throughput"].asDouble());
+	PRINT_I("Latency (us): p50 %llu, p90 %llu, p99 %llu, p999 %llu, max %llu.",
+		static_cast<unsigned long long>(result->m_latency.GetPercentile(50.0)),
+		static_cast<unsigned long long>(result->m_latency.GetPercentile(90.0)),
+		static_cast<unsigned long long>(result->m_latency.GetPercentile(99.0)),
+		static_cast<unsigned long long>(result->m_latency.GetPercentile(99.9)),
+		static_cast<unsigned long long>(result->m_latency.GetMax()));
+
+	Json::StreamWriterBuilder writerBuilder;
+	writerBuilder["indentation"] = "\t";
+	const std::string resultStr = Json::writeString(writerBuilder, resultJson);
+	if (outputArg.getValue().size() > 0)
+	{
+		std::ofstream outFile(outputArg.getValue());
+		outFile << resultStr << std::endl;
+		if (!outFile)
+		{
+			PRINT_W("Failed to write the result to %s.", outputArg.getValue().c_str());
+			return -1;
+		}
+	}
+	else
+	{
+		std::cout << resultStr << std::endl;
+	}
+
+	return 0;
+}
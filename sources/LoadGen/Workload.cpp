@@ -0,0 +1,86 @@
+#include "Workload.h"
+
+#include <stdexcept>
+
+#include <DecentApi/Common/Net/ConnectionBase.h>
+
+using namespace Decent;
+using namespace Decent::LoadGen;
+
+namespace
+{
+	static constexpr uint16_t gsk_iasSimPort = 57720;
+	static constexpr uint16_t gsk_decentServerPort = 57755;
+
+	//Same GID format as the SigRL path of IAS, i.e. 8 hex digits.
+	static constexpr char gsk_sigRlGid[] = "00000B31";
+
+	//Encoded size of a typical EPID quote (1116 bytes), which is also long enough for IAS Simulator to copy the
+	//	quote body from when it signs reports.
+	static constexpr size_t gsk_quoteB64Size = 1488;
+
+	//A well-formed report request; the quote is a placeholder of zeros, since IAS Simulator doesn't verify it.
+	static std::string GetReportReq()
+	{
+		return "{\"isvEnclaveQuote\":\"" + std::string(gsk_quoteB64Size, 'A') + "\",\"nonce\":\"AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA\"}";
+	}
+}
+
+RequestWorkload::RequestWorkload(const std::string & category, const std::string & payload) :
+	RequestWorkload(std::vector<Exchange>{ Exchange(category, payload) })
+{
+}
+
+RequestWorkload::RequestWorkload(std::vector<Exchange> exchanges) :
+	m_exchanges(std::move(exchanges))
+{
+}
+
+RequestWorkload::~RequestWorkload()
+{
+}
+
+void RequestWorkload::Run(Net::ConnectionBase & connection) const
+{
+	for (const Exchange& exchange : m_exchanges)
+	{
+		connection.SendContainer(exchange.first);
+		connection.SendContainer(exchange.second);
+
+		std::string reply = connection.RecvContainer<std::string>();
+	}
+}
+
+std::unique_ptr<RequestWorkload> LoadGen::CreateWorkload(const std::string & name, const std::string & category, const std::string & payload)
+{
+	if (name == "ias-sigrl")
+	{
+		return std::unique_ptr<RequestWorkload>(new RequestWorkload("SigRl", gsk_sigRlGid));
+	}
+	else if (name == "ias-report")
+	{
+		return std::unique_ptr<RequestWorkload>(new RequestWorkload("Report", GetReportReq()));
+	}
+	else if (name == "ias-attestation")
+	{
+		//The Decent Server gets the SigRL of the platform first, and then has the quote verified.
+		return std::unique_ptr<RequestWorkload>(new RequestWorkload(std::vector<RequestWorkload::Exchange>{
+			RequestWorkload::Exchange("SigRl", gsk_sigRlGid),
+			RequestWorkload::Exchange("Report", GetReportReq()) }));
+	}
+	else if (name == "request")
+	{
+		if (category.empty())
+		{
+			throw std::runtime_error("The request workload needs a category.");
+		}
+		return std::unique_ptr<RequestWorkload>(new RequestWorkload(category, payload));
+	}
+
+	throw std::runtime_error("Unknown workload " + name + ".");
+}
+
+uint16_t LoadGen::GetDefaultPort(const std::string & name) noexcept
+{
+	return name.compare(0, 4, "ias-") == 0 ? gsk_iasSimPort : gsk_decentServerPort;
+}
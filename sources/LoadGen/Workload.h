@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <utility>
+
+namespace Decent
+{
+	namespace Net
+	{
+		class ConnectionBase;
+	}
+
+	namespace LoadGen
+	{
+		/**
+		 * \brief	Request-reply exchanges over one smart message connection: for each exchange, the
+		 * 			category is sent, followed by one payload message, and then one reply message is
+		 * 			received. The connection is kept alive from one exchange to the next.
+		 */
+		class RequestWorkload
+		{
+		public:
+			/** \brief	An exchange, as the category and the payload. */
+			typedef std::pair<std::string, std::string> Exchange;
+
+		public:
+			RequestWorkload(const std::string& category, const std::string& payload);
+
+			RequestWorkload(std::vector<Exchange> exchanges);
+
+			virtual ~RequestWorkload();
+
+			/**
+			 * \brief	Runs all the exchanges once, in order.
+			 *
+			 * \exception	std::exception	Thrown if an exchange fails.
+			 *
+			 * \param [in,out]	connection	A newly established connection.
+			 */
+			virtual void Run(Net::ConnectionBase& connection) const;
+
+		private:
+			std::vector<Exchange> m_exchanges;
+		};
+
+		/**
+		 * \brief	Creates a workload by its name. Supported workloads are "ias-sigrl" and "ias-report"
+		 * 			(i.e. the requests the Decent Server sends to IAS Simulator), "ias-attestation" (both
+		 * 			of them in a row, as in one remote attestation), and "request", which sends the given
+		 * 			payload with the given category.
+		 *
+		 * \exception	std::runtime_error	Thrown if the name is unknown.
+		 *
+		 * \param	name		The name of the workload.
+		 * \param	category	The category, for the "request" workload.
+		 * \param	payload 	The payload, for the "request" workload.
+		 *
+		 * \return	The workload.
+		 */
+		std::unique_ptr<RequestWorkload> CreateWorkload(const std::string& name, const std::string& category, const std::string& payload);
+
+		/**
+		 * \brief	Gets the default port of the server a workload is meant for, i.e. IAS Simulator's for the
+		 * 			"ias-*" workloads, and the Decent Server's for the others.
+		 *
+		 * \param	name	The name of the workload.
+		 *
+		 * \return	The default port.
+		 */
+		uint16_t GetDefaultPort(const std::string& name) noexcept;
+	}
+}
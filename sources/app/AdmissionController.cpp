@@ -0,0 +1,119 @@
+#include "AdmissionController.h"
+
+#include <cstring>
+
+#include <json/json.h>
+
+#include <DecentApi/Common/Net/ConnectionBase.h>
+
+#include "ServerMetrics.h"
+
+using namespace Decent;
+using namespace Decent::ServerApp;
+
+constexpr char const AdmissionController::sk_statusBusy[];
+
+namespace
+{
+	/** \brief	Weight of a new sample in the moving average of the service time, as a right shift. */
+	static constexpr unsigned int gsk_ewmaShift = 3;
+
+	static uint64_t ToUs(AdmissionController::Clock::duration duration)
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+	}
+}
+
+AdmissionController::AdmissionController(size_t maxInSystem, Clock::duration deadline, std::shared_ptr<ServerMetrics> metrics) :
+	m_maxInSystem(maxInSystem),
+	m_deadline(deadline),
+	m_metrics(metrics),
+	m_inSystem(0),
+	m_serviceEwmaUs(0),
+	m_workers(1)
+{
+}
+
+AdmissionController::~AdmissionController()
+{
+}
+
+bool AdmissionController::TryEnter() noexcept
+{
+	const uint64_t inSystem = m_inSystem.fetch_add(1, std::memory_order_relaxed);
+
+	const bool isFull = m_maxInSystem > 0 && inSystem >= m_maxInSystem;
+	const bool isTooLate = m_deadline > Clock::duration::zero() &&
+		EstimateWaitMs() * 1000 + m_serviceEwmaUs.load(std::memory_order_relaxed) > ToUs(m_deadline);
+	if (isFull || isTooLate)
+	{
+		m_inSystem.fetch_sub(1, std::memory_order_relaxed);
+		m_metrics->m_admissionRejectedCnt.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	return true;
+}
+
+void AdmissionController::Leave() noexcept
+{
+	m_inSystem.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool AdmissionController::IsInTime(Clock::time_point acceptTime, Clock::time_point now) noexcept
+{
+	if (m_deadline <= Clock::duration::zero())
+	{
+		return true;
+	}
+
+	const uint64_t waited = ToUs(now - acceptTime);
+	if (waited + m_serviceEwmaUs.load(std::memory_order_relaxed) > ToUs(m_deadline))
+	{
+		m_metrics->m_deadlineShedCnt.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	return true;
+}
+
+void AdmissionController::RecordService(Clock::duration serviceTime) noexcept
+{
+	const uint64_t sample = ToUs(serviceTime);
+	const uint64_t old = m_serviceEwmaUs.load(std::memory_order_relaxed);
+
+	//Races only lose a sample, which is fine for an estimation.
+	m_serviceEwmaUs.store(old == 0 ? sample :
+		(old - (old >> gsk_ewmaShift) + (sample >> gsk_ewmaShift)), std::memory_order_relaxed);
+}
+
+uint64_t AdmissionController::EstimateWaitMs() const noexcept
+{
+	const size_t workers = m_workers.load(std::memory_order_relaxed);
+	const uint64_t inSystem = m_inSystem.load(std::memory_order_relaxed);
+	const uint64_t rounds = (inSystem + workers - 1) / workers;
+	return (rounds * m_serviceEwmaUs.load(std::memory_order_relaxed)) / 1000;
+}
+
+void AdmissionController::RejectConnection(Net::ConnectionBase & connection) const noexcept
+{
+	try
+	{
+		Json::Value reply;
+		reply["Status"] = sk_statusBusy;
+		reply["RetryAfter"] = static_cast<Json::UInt64>(EstimateWaitMs());
+
+		Json::StreamWriterBuilder writerBuilder;
+		writerBuilder["indentation"] = "";
+		const std::string replyStr = Json::writeString(writerBuilder, reply);
+
+		//Framed the same as SendContainer does, but sent with a single SendRaw; it's called on the
+		//accepting thread, which must not wait for a client that doesn't read.
+		const uint64_t replySize = replyStr.size();
+		std::string msg(sizeof(replySize), '\0');
+		std::memcpy(&msg[0], &replySize, sizeof(replySize));
+		msg += replyStr;
+		connection.SendRaw(msg.data(), msg.size());
+	}
+	catch (const std::exception&)
+	{}
+	connection.Terminate();
+}
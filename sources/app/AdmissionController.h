@@ -0,0 +1,115 @@
+#pragma once
+
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+namespace Decent
+{
+	namespace Net
+	{
+		class ConnectionBase;
+	}
+
+	namespace ServerApp
+	{
+		class ServerMetrics;
+
+		/**
+		 * \brief	Decides whether new attestation requests are let in. A connection is in the system from
+		 * 			being accepted until its first message is handled; their number is bounded, and a
+		 * 			request is turned away early if it would likely miss the client's deadline anyway.
+		 *
+		 * 			Rejected clients get a busy reply with a retry-after hint, in place of the first reply
+		 * 			of the protocol: one message (an 8-byte length followed by the data) carrying
+		 * 			{"Status":"Busy","RetryAfter":MS}, after which the connection is closed. A client
+		 * 			that knows the format may retry after MS milliseconds; any other client fails to
+		 * 			parse it, and sees a failed handshake, as if the connection were dropped.
+		 */
+		class AdmissionController
+		{
+		public:
+			typedef std::chrono::steady_clock Clock;
+
+			static constexpr char const sk_statusBusy[] = "Busy";
+
+		public:
+			/**
+			 * \brief	Constructor
+			 *
+			 * \param	maxInSystem	Maximum number of connections in the system; zero for no limit.
+			 * \param	deadline   	How long a client waits for its handshake; zero for no deadline.
+			 * \param	metrics	   	The metrics to update.
+			 */
+			AdmissionController(size_t maxInSystem, Clock::duration deadline, std::shared_ptr<ServerMetrics> metrics);
+
+			virtual ~AdmissionController();
+
+			/**
+			 * \brief	Tries to let a newly accepted connection in. Leave() must be called once for each
+			 * 			successful call.
+			 *
+			 * \return	True if it's admitted.
+			 */
+			bool TryEnter() noexcept;
+
+			void Leave() noexcept;
+
+			/**
+			 * \brief	Checks, when a worker picks up the first message of a connection, if the handshake
+			 * 			can still finish before the deadline.
+			 *
+			 * \param	acceptTime	When the connection was accepted.
+			 * \param	now		  	The current time.
+			 *
+			 * \return	True if it should be handled; false if it should be shed.
+			 */
+			bool IsInTime(Clock::time_point acceptTime, Clock::time_point now) noexcept;
+
+			/**
+			 * \brief	Records how long a handshake took, which the wait estimations are based on.
+			 *
+			 * \param	serviceTime	The time spent in the handler.
+			 */
+			void RecordService(Clock::duration serviceTime) noexcept;
+
+			/**
+			 * \brief	Sets number of workers draining the system.
+			 *
+			 * \param	workers	The number of workers.
+			 */
+			void SetWorkers(size_t workers) noexcept { m_workers = workers > 0 ? workers : 1; }
+
+			/**
+			 * \brief	Gets how long a new request would wait before a worker picks it up, i.e. the
+			 * 			retry-after hint.
+			 *
+			 * \return	The estimated wait, in milliseconds.
+			 */
+			uint64_t EstimateWaitMs() const noexcept;
+
+			/**
+			 * \brief	Sends the busy reply, {"Status" : "Busy", "RetryAfter" : MS}, as one message, and
+			 * 			closes the connection. Errors are ignored; the client is going away anyway.
+			 *
+			 * 			The reply is given to the connection in one send, and isn't retried if only part of
+			 * 			it is taken, so it never waits for the client to read. Nothing has been sent on the
+			 * 			connection yet, so the few bytes fit in the empty send buffer.
+			 *
+			 * \param [in,out]	connection	The connection.
+			 */
+			void RejectConnection(Net::ConnectionBase& connection) const noexcept;
+
+		private:
+			const size_t m_maxInSystem;
+			const Clock::duration m_deadline;
+			std::shared_ptr<ServerMetrics> m_metrics;
+
+			std::atomic<uint64_t> m_inSystem;
+			/** \brief	Exponentially weighted moving average of the service time, in microseconds. */
+			std::atomic<uint64_t> m_serviceEwmaUs;
+			std::atomic<size_t> m_workers;
+		};
+	}
+}
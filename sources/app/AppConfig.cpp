@@ -0,0 +1,253 @@
+#include "AppConfig.h"
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+#include <json/json.h>
+
+using namespace Decent;
+using namespace Decent::ServerApp;
+
+namespace
+{
+	static Json::Value ParseConfigJson(const std::string& jsonStr)
+	{
+		Json::CharReaderBuilder builder;
+		std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+
+		Json::Value root;
+		std::string errMsg;
+		if (!reader->parse(jsonStr.data(), jsonStr.data() + jsonStr.size(), &root, &errMsg))
+		{
+			throw std::runtime_error("Failed to parse the configuration file. " + errMsg);
+		}
+		return root;
+	}
+
+	static const Json::Value& GetObjectOrNull(const Json::Value& json, const char* key)
+	{
+		static const Json::Value nullVal;
+
+		if (!json.isObject() || !json.isMember(key))
+		{
+			return nullVal;
+		}
+		if (!json[key].isObject())
+		{
+			throw std::runtime_error(std::string("Config field \"") + key + "\" must be an object.");
+		}
+		return json[key];
+	}
+
+	static uint64_t GetOptUInt(const Json::Value& json, const char* key, uint64_t defaultVal)
+	{
+		if (!json.isObject() || !json.isMember(key))
+		{
+			return defaultVal;
+		}
+		if (!json[key].isUInt64())
+		{
+			throw std::runtime_error(std::string("Config field \"") + key + "\" must be an unsigned integer.");
+		}
+		return json[key].asUInt64();
+	}
+
+	static bool GetOptBool(const Json::Value& json, const char* key, bool defaultVal)
+	{
+		if (!json.isObject() || !json.isMember(key))
+		{
+			return defaultVal;
+		}
+		if (!json[key].isBool())
+		{
+			throw std::runtime_error(std::string("Config field \"") + key + "\" must be a boolean.");
+		}
+		return json[key].asBool();
+	}
+
+	static std::string GetOptString(const Json::Value& json, const char* key, const std::string& defaultVal)
+	{
+		if (!json.isObject() || !json.isMember(key))
+		{
+			return defaultVal;
+		}
+		if (!json[key].isString())
+		{
+			throw std::runtime_error(std::string("Config field \"") + key + "\" must be a string.");
+		}
+		return json[key].asString();
+	}
+}
+
+constexpr char const FrontEndConfig::sk_keyWorkerThreads[];
+constexpr char const FrontEndConfig::sk_keyConnectionPoolSize[];
+constexpr char const FrontEndConfig::sk_keyKeepAlive[];
+constexpr char const FrontEndConfig::sk_keyTcpServerMode[];
+constexpr char const FrontEndConfig::sk_keyTcpAcceptors[];
+constexpr char const FrontEndConfig::sk_tcpModeBlocking[];
+constexpr char const FrontEndConfig::sk_tcpModeEpoll[];
+
+FrontEndConfig::FrontEndConfig(const Json::Value & json) :
+	m_workerThreads(static_cast<size_t>(GetOptUInt(json, sk_keyWorkerThreads, 0))),
+	m_cntPoolSize(static_cast<size_t>(GetOptUInt(json, sk_keyConnectionPoolSize, 1000))),
+	m_keepAlive(GetOptBool(json, sk_keyKeepAlive, true)),
+	m_isEpollTcpServer(false),
+	m_tcpAcceptors(static_cast<size_t>(GetOptUInt(json, sk_keyTcpAcceptors, 2)))
+{
+	const std::string tcpMode = GetOptString(json, sk_keyTcpServerMode, sk_tcpModeBlocking);
+	if (tcpMode == sk_tcpModeEpoll)
+	{
+		m_isEpollTcpServer = true;
+	}
+	else if (tcpMode != sk_tcpModeBlocking)
+	{
+		throw std::runtime_error(std::string("Config field \"") + sk_keyTcpServerMode + "\" must be \"" +
+			sk_tcpModeBlocking + "\" or \"" + sk_tcpModeEpoll + "\".");
+	}
+	if (m_tcpAcceptors == 0)
+	{
+		throw std::runtime_error(std::string("Config field \"") + sk_keyTcpAcceptors + "\" must be at least one.");
+	}
+}
+
+FrontEndConfig::~FrontEndConfig()
+{
+}
+
+constexpr char const SwitchlessConfig::sk_keyEnabled[];
+constexpr char const SwitchlessConfig::sk_keyUntrustedWorkers[];
+constexpr char const SwitchlessConfig::sk_keyTrustedWorkers[];
+
+SwitchlessConfig::SwitchlessConfig(const Json::Value & json) :
+	m_enabled(GetOptBool(json, sk_keyEnabled, false)),
+	m_untrustedWorkers(static_cast<size_t>(GetOptUInt(json, sk_keyUntrustedWorkers, 2))),
+	m_trustedWorkers(static_cast<size_t>(GetOptUInt(json, sk_keyTrustedWorkers, 0)))
+{
+}
+
+SwitchlessConfig::~SwitchlessConfig()
+{
+}
+
+constexpr char const MetricsConfig::sk_keyPrometheusFile[];
+constexpr char const MetricsConfig::sk_keyDumpInterval[];
+
+MetricsConfig::MetricsConfig(const Json::Value & json) :
+	m_prometheusFile(GetOptString(json, sk_keyPrometheusFile, "")),
+	m_dumpInterval(GetOptUInt(json, sk_keyDumpInterval, 10))
+{
+}
+
+MetricsConfig::~MetricsConfig()
+{
+}
+
+constexpr char const AdmissionConfig::sk_keyMaxInSystem[];
+constexpr char const AdmissionConfig::sk_keyDeadline[];
+constexpr char const AdmissionConfig::sk_keyMaxIasInFlight[];
+constexpr char const AdmissionConfig::sk_keyIasMaxWait[];
+
+AdmissionConfig::AdmissionConfig(const Json::Value & json) :
+	m_maxInSystem(static_cast<size_t>(GetOptUInt(json, sk_keyMaxInSystem, 0))),
+	m_deadline(GetOptUInt(json, sk_keyDeadline, 0)),
+	m_maxIasInFlight(static_cast<size_t>(GetOptUInt(json, sk_keyMaxIasInFlight, 0))),
+	m_iasMaxWait(GetOptUInt(json, sk_keyIasMaxWait, 5000))
+{
+}
+
+AdmissionConfig::~AdmissionConfig()
+{
+}
+
+constexpr char const LocalShmConfig::sk_keyEnabled[];
+constexpr char const LocalShmConfig::sk_keyRingSize[];
+
+LocalShmConfig::LocalShmConfig(const Json::Value & json) :
+	m_enabled(GetOptBool(json, sk_keyEnabled, false)),
+	m_ringSize(0)
+{
+	const uint64_t ringSizeKiB = GetOptUInt(json, sk_keyRingSize, 256);
+	if (ringSizeKiB == 0 || ringSizeKiB > (1ULL << 20))
+	{
+		throw std::runtime_error(std::string("Config field \"") + sk_keyRingSize + "\" must be between 1 and 1048576.");
+	}
+
+	m_ringSize = 1024;
+	while (m_ringSize < ringSizeKiB * 1024)
+	{
+		m_ringSize <<= 1;
+	}
+}
+
+LocalShmConfig::~LocalShmConfig()
+{
+}
+
+constexpr char const TraceConfig::sk_keyFile[];
+constexpr char const TraceConfig::sk_keyBufferSize[];
+constexpr char const TraceConfig::sk_keyFlushInterval[];
+
+TraceConfig::TraceConfig(const Json::Value & json) :
+	m_file(GetOptString(json, sk_keyFile, "")),
+	m_bufferSize(static_cast<size_t>(GetOptUInt(json, sk_keyBufferSize, 16384))),
+	m_flushInterval(GetOptUInt(json, sk_keyFlushInterval, 1000))
+{
+	if (m_bufferSize == 0)
+	{
+		throw std::runtime_error(std::string("Config field \"") + sk_keyBufferSize + "\" must be at least one.");
+	}
+}
+
+TraceConfig::~TraceConfig()
+{
+}
+
+constexpr char const ServiceProviderConfig::sk_keySigRlCacheTtl[];
+constexpr char const ServiceProviderConfig::sk_keyIasUrl[];
+constexpr char const ServiceProviderConfig::sk_keyHttpPoolSize[];
+constexpr char const ServiceProviderConfig::sk_keyHttpIdleTimeout[];
+constexpr char const ServiceProviderConfig::sk_keyHttp2[];
+constexpr char const ServiceProviderConfig::sk_keyHttpPrewarm[];
+
+ServiceProviderConfig::ServiceProviderConfig(const Json::Value & json) :
+	m_sigRlCacheTtl(GetOptUInt(json, sk_keySigRlCacheTtl, 60)),
+	m_iasUrl(GetOptString(json, sk_keyIasUrl, "https://api.trustedservices.intel.com/sgx/dev/attestation/v3")),
+	m_httpPoolSize(static_cast<size_t>(GetOptUInt(json, sk_keyHttpPoolSize, 0))),
+	m_httpIdleTimeout(GetOptUInt(json, sk_keyHttpIdleTimeout, 120)),
+	m_isHttp2(GetOptBool(json, sk_keyHttp2, false)),
+	m_isHttpPrewarm(GetOptBool(json, sk_keyHttpPrewarm, false))
+{
+}
+
+ServiceProviderConfig::~ServiceProviderConfig()
+{
+}
+
+constexpr char const AppConfig::sk_keyDecentServer[];
+constexpr char const AppConfig::sk_keySgxServiceProvider[];
+constexpr char const AppConfig::sk_keySwitchless[];
+constexpr char const AppConfig::sk_keyMetrics[];
+constexpr char const AppConfig::sk_keyAdmission[];
+constexpr char const AppConfig::sk_keyLocalShm[];
+constexpr char const AppConfig::sk_keyTrace[];
+
+AppConfig::AppConfig(const std::string & jsonStr) :
+	AppConfig(ParseConfigJson(jsonStr))
+{
+}
+
+AppConfig::AppConfig(const Json::Value & json) :
+	m_frontEnd(GetObjectOrNull(json, sk_keyDecentServer)),
+	m_switchless(GetObjectOrNull(GetObjectOrNull(json, sk_keyDecentServer), sk_keySwitchless)),
+	m_serviceProvider(GetObjectOrNull(json, sk_keySgxServiceProvider)),
+	m_metrics(GetObjectOrNull(GetObjectOrNull(json, sk_keyDecentServer), sk_keyMetrics)),
+	m_admission(GetObjectOrNull(GetObjectOrNull(json, sk_keyDecentServer), sk_keyAdmission)),
+	m_localShm(GetObjectOrNull(GetObjectOrNull(json, sk_keyDecentServer), sk_keyLocalShm)),
+	m_trace(GetObjectOrNull(GetObjectOrNull(json, sk_keyDecentServer), sk_keyTrace))
+{
+}
+
+AppConfig::~AppConfig()
+{
+}
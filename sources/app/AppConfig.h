@@ -0,0 +1,406 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Json
+{
+	class Value;
+}
+
+namespace Decent
+{
+	namespace ServerApp
+	{
+		/**
+		 * \brief	Front end (i.e. the smart server) settings, read from the "DecentServer" object in
+		 * 			the configuration file. All fields are optional.
+		 */
+		class FrontEndConfig
+		{
+		public:
+			static constexpr char const sk_keyWorkerThreads[] = "WorkerThreads";
+			static constexpr char const sk_keyConnectionPoolSize[] = "ConnectionPoolSize";
+			static constexpr char const sk_keyKeepAlive[] = "KeepAlive";
+			static constexpr char const sk_keyTcpServerMode[] = "TcpServerMode";
+			static constexpr char const sk_keyTcpAcceptors[] = "TcpAcceptors";
+
+			static constexpr char const sk_tcpModeBlocking[] = "blocking";
+			static constexpr char const sk_tcpModeEpoll[] = "epoll";
+
+		public:
+			FrontEndConfig(const Json::Value& json);
+
+			virtual ~FrontEndConfig();
+
+			/**
+			 * \brief	Gets number of worker threads. Zero means one worker per hardware thread.
+			 *
+			 * \return	The number of worker threads.
+			 */
+			size_t GetWorkerThreads() const noexcept { return m_workerThreads; }
+
+			/**
+			 * \brief	Gets the maximum number of idle connections kept alive by the connection pool.
+			 *
+			 * \return	The connection pool size.
+			 */
+			size_t GetConnectionPoolSize() const noexcept { return m_cntPoolSize; }
+
+			bool IsKeepAlive() const noexcept { return m_keepAlive; }
+
+			/**
+			 * \brief	Query if the TCP server is readiness-based ("epoll"), instead of the default
+			 * 			blocking server ("blocking").
+			 *
+			 * \return	True if the epoll TCP server is used.
+			 */
+			bool IsEpollTcpServer() const noexcept { return m_isEpollTcpServer; }
+
+			/**
+			 * \brief	Gets number of acceptor threads of the epoll TCP server, each with its own
+			 * 			listening socket on the port.
+			 *
+			 * \return	The number of acceptors, at least one.
+			 */
+			size_t GetTcpAcceptors() const noexcept { return m_tcpAcceptors; }
+
+		private:
+			size_t m_workerThreads;
+			size_t m_cntPoolSize;
+			bool m_keepAlive;
+			bool m_isEpollTcpServer;
+			size_t m_tcpAcceptors;
+		};
+
+		/**
+		 * \brief	Switchless call settings, read from the "Switchless" object inside the "DecentServer"
+		 * 			object in the configuration file. All fields are optional; it's off by default.
+		 */
+		class SwitchlessConfig
+		{
+		public:
+			static constexpr char const sk_keyEnabled[] = "Enabled";
+			static constexpr char const sk_keyUntrustedWorkers[] = "UntrustedWorkers";
+			static constexpr char const sk_keyTrustedWorkers[] = "TrustedWorkers";
+
+		public:
+			SwitchlessConfig(const Json::Value& json);
+
+			virtual ~SwitchlessConfig();
+
+			bool IsEnabled() const noexcept { return m_enabled; }
+
+			/**
+			 * \brief	Gets number of untrusted worker threads, which serve switchless OCALLs.
+			 *
+			 * \return	The number of untrusted workers.
+			 */
+			size_t GetUntrustedWorkers() const noexcept { return m_untrustedWorkers; }
+
+			/**
+			 * \brief	Gets number of trusted worker threads, which serve switchless ECALLs.
+			 *
+			 * \return	The number of trusted workers.
+			 */
+			size_t GetTrustedWorkers() const noexcept { return m_trustedWorkers; }
+
+		private:
+			bool m_enabled;
+			size_t m_untrustedWorkers;
+			size_t m_trustedWorkers;
+		};
+
+		/**
+		 * \brief	Metrics settings, read from the "Metrics" object inside the "DecentServer" object in
+		 * 			the configuration file. All fields are optional. The metrics are always collected,
+		 * 			and can be queried with the "Stats" message through the local server; these
+		 * 			settings only control the periodic dump in Prometheus text format.
+		 */
+		class MetricsConfig
+		{
+		public:
+			static constexpr char const sk_keyPrometheusFile[] = "PrometheusFile";
+			static constexpr char const sk_keyDumpInterval[] = "DumpInterval";
+
+		public:
+			MetricsConfig(const Json::Value& json);
+
+			virtual ~MetricsConfig();
+
+			/**
+			 * \brief	Gets the path of the file the metrics are dumped to (e.g. for the textfile
+			 * 			collector of node_exporter). Empty means no dump.
+			 *
+			 * \return	The path.
+			 */
+			const std::string& GetPrometheusFile() const noexcept { return m_prometheusFile; }
+
+			/**
+			 * \brief	Gets the dump interval, in seconds.
+			 *
+			 * \return	The dump interval.
+			 */
+			uint64_t GetDumpInterval() const noexcept { return m_dumpInterval; }
+
+		private:
+			std::string m_prometheusFile;
+			uint64_t m_dumpInterval;
+		};
+
+		/**
+		 * \brief	Admission control settings, read from the "Admission" object inside the
+		 * 			"DecentServer" object in the configuration file. All fields are optional; everything
+		 * 			is let in by default. It only applies to the TCP server. Rejected clients get a busy
+		 * 			reply instead of the protocol reply (see AdmissionController).
+		 */
+		class AdmissionConfig
+		{
+		public:
+			static constexpr char const sk_keyMaxInSystem[] = "MaxInSystem";
+			static constexpr char const sk_keyDeadline[] = "Deadline";
+			static constexpr char const sk_keyMaxIasInFlight[] = "MaxIasInFlight";
+			static constexpr char const sk_keyIasMaxWait[] = "IasMaxWait";
+
+		public:
+			AdmissionConfig(const Json::Value& json);
+
+			virtual ~AdmissionConfig();
+
+			/**
+			 * \brief	Gets the maximum number of connections accepted but whose first message isn't
+			 * 			handled yet. Zero means no limit.
+			 *
+			 * \return	The maximum number of connections in the system.
+			 */
+			size_t GetMaxInSystem() const noexcept { return m_maxInSystem; }
+
+			/**
+			 * \brief	Gets how long (in milliseconds) clients wait for their handshakes. Requests that
+			 * 			would likely miss it are turned away. Zero means no deadline.
+			 *
+			 * \return	The deadline.
+			 */
+			uint64_t GetDeadline() const noexcept { return m_deadline; }
+
+			/**
+			 * \brief	Gets the maximum number of requests in flight to IAS. Zero means no limit.
+			 *
+			 * \return	The maximum number of IAS requests in flight.
+			 */
+			size_t GetMaxIasInFlight() const noexcept { return m_maxIasInFlight; }
+
+			/**
+			 * \brief	Gets how long (in milliseconds) an IAS request waits for its turn before it fails.
+			 *
+			 * \return	The maximum wait.
+			 */
+			uint64_t GetIasMaxWait() const noexcept { return m_iasMaxWait; }
+
+			bool IsEnabled() const noexcept { return m_maxInSystem > 0 || m_deadline > 0; }
+
+		private:
+			size_t m_maxInSystem;
+			uint64_t m_deadline;
+			size_t m_maxIasInFlight;
+			uint64_t m_iasMaxWait;
+		};
+
+		/**
+		 * \brief	Shared-memory local server settings, read from the "LocalShm" object inside the
+		 * 			"DecentServer" object in the configuration file. All fields are optional; it's off by
+		 * 			default.
+		 */
+		class LocalShmConfig
+		{
+		public:
+			static constexpr char const sk_keyEnabled[] = "Enabled";
+			static constexpr char const sk_keyRingSize[] = "RingSize";
+
+		public:
+			LocalShmConfig(const Json::Value& json);
+
+			virtual ~LocalShmConfig();
+
+			bool IsEnabled() const noexcept { return m_enabled; }
+
+			/**
+			 * \brief	Gets the size (in bytes) of each direction's ring buffer of a connection. It's
+			 * 			given in KiB in the configuration file, and rounded up to a power of two.
+			 *
+			 * \return	The ring size.
+			 */
+			size_t GetRingSize() const noexcept { return m_ringSize; }
+
+		private:
+			bool m_enabled;
+			size_t m_ringSize;
+		};
+
+		/**
+		 * \brief	Tracing settings, read from the "Trace" object inside the "DecentServer" object in the
+		 * 			configuration file. All fields are optional; it's off by default. When on, spans of
+		 * 			every connection (accept, queue wait, enclave calls, IAS requests, sends) are written
+		 * 			to the file in the Chrome trace-event format.
+		 */
+		class TraceConfig
+		{
+		public:
+			static constexpr char const sk_keyFile[] = "File";
+			static constexpr char const sk_keyBufferSize[] = "BufferSize";
+			static constexpr char const sk_keyFlushInterval[] = "FlushInterval";
+
+		public:
+			TraceConfig(const Json::Value& json);
+
+			virtual ~TraceConfig();
+
+			/**
+			 * \brief	Gets the path of the trace file; events are appended to it. Empty means no tracing.
+			 *
+			 * \return	The path.
+			 */
+			const std::string& GetFile() const noexcept { return m_file; }
+
+			/**
+			 * \brief	Gets number of spans each thread can hold until they are written; more are dropped.
+			 *
+			 * \return	The buffer size.
+			 */
+			size_t GetBufferSize() const noexcept { return m_bufferSize; }
+
+			/**
+			 * \brief	Gets how often (in milliseconds) the spans are written to the file.
+			 *
+			 * \return	The flush interval.
+			 */
+			uint64_t GetFlushInterval() const noexcept { return m_flushInterval; }
+
+		private:
+			std::string m_file;
+			size_t m_bufferSize;
+			uint64_t m_flushInterval;
+		};
+
+		/**
+		 * \brief	Extra IAS client settings, read from the "SgxServiceProvider" object in the
+		 * 			configuration file. All fields are optional.
+		 */
+		class ServiceProviderConfig
+		{
+		public:
+			static constexpr char const sk_keySigRlCacheTtl[] = "SigRlCacheTtl";
+			static constexpr char const sk_keyIasUrl[] = "IasUrl";
+			static constexpr char const sk_keyHttpPoolSize[] = "HttpPoolSize";
+			static constexpr char const sk_keyHttpIdleTimeout[] = "HttpIdleTimeout";
+			static constexpr char const sk_keyHttp2[] = "Http2";
+			static constexpr char const sk_keyHttpPrewarm[] = "HttpPrewarm";
+
+		public:
+			ServiceProviderConfig(const Json::Value& json);
+
+			virtual ~ServiceProviderConfig();
+
+			/**
+			 * \brief	Gets how long (in seconds) a SigRL is cached for. Zero turns off the cache.
+			 *
+			 * \return	The SigRL cache TTL.
+			 */
+			uint64_t GetSigRlCacheTtl() const noexcept { return m_sigRlCacheTtl; }
+
+			/**
+			 * \brief	Gets the base URL of the IAS attestation API, used by the pooled IAS connector.
+			 *
+			 * \return	The URL.
+			 */
+			const std::string& GetIasUrl() const noexcept { return m_iasUrl; }
+
+			/**
+			 * \brief	Gets number of reusable HTTP handles to IAS. Zero turns off the pooled IAS
+			 * 			connector, and the one from DecentApi is used instead.
+			 *
+			 * \return	The HTTP pool size.
+			 */
+			size_t GetHttpPoolSize() const noexcept { return m_httpPoolSize; }
+
+			/**
+			 * \brief	Gets how long (in seconds) an idle connection to IAS is kept for reuse.
+			 *
+			 * \return	The HTTP idle timeout.
+			 */
+			uint64_t GetHttpIdleTimeout() const noexcept { return m_httpIdleTimeout; }
+
+			/**
+			 * \brief	Checks if HTTP/2 is negotiated with IAS. Each handle of the pooled connector still
+			 * 			sends one request at a time on its own connection, so it doesn't multiplex requests
+			 * 			there.
+			 *
+			 * \return	True if HTTP/2 is on.
+			 */
+			bool IsHttp2() const noexcept { return m_isHttp2; }
+
+			/**
+			 * \brief	Checks if the connections to IAS are opened at startup.
+			 *
+			 * \return	True if pre-warming is on.
+			 */
+			bool IsHttpPrewarm() const noexcept { return m_isHttpPrewarm; }
+
+		private:
+			uint64_t m_sigRlCacheTtl;
+			std::string m_iasUrl;
+			size_t m_httpPoolSize;
+			uint64_t m_httpIdleTimeout;
+			bool m_isHttp2;
+			bool m_isHttpPrewarm;
+		};
+
+		/**
+		 * \brief	Settings of the Decent Server app that are not covered by Sgx::DecentServerConfig.
+		 * 			They are read from the same configuration file.
+		 */
+		class AppConfig
+		{
+		public:
+			static constexpr char const sk_keyDecentServer[] = "DecentServer";
+			static constexpr char const sk_keySgxServiceProvider[] = "SgxServiceProvider";
+			static constexpr char const sk_keySwitchless[] = "Switchless";
+			static constexpr char const sk_keyMetrics[] = "Metrics";
+			static constexpr char const sk_keyAdmission[] = "Admission";
+			static constexpr char const sk_keyLocalShm[] = "LocalShm";
+			static constexpr char const sk_keyTrace[] = "Trace";
+
+		public:
+			AppConfig(const std::string& jsonStr);
+
+			virtual ~AppConfig();
+
+			const FrontEndConfig& GetFrontEndConfig() const noexcept { return m_frontEnd; }
+
+			const SwitchlessConfig& GetSwitchlessConfig() const noexcept { return m_switchless; }
+
+			const ServiceProviderConfig& GetServiceProviderConfig() const noexcept { return m_serviceProvider; }
+
+			const MetricsConfig& GetMetricsConfig() const noexcept { return m_metrics; }
+
+			const AdmissionConfig& GetAdmissionConfig() const noexcept { return m_admission; }
+
+			const LocalShmConfig& GetLocalShmConfig() const noexcept { return m_localShm; }
+
+			const TraceConfig& GetTraceConfig() const noexcept { return m_trace; }
+
+		private:
+			AppConfig(const Json::Value& json);
+
+			FrontEndConfig m_frontEnd;
+			SwitchlessConfig m_switchless;
+			ServiceProviderConfig m_serviceProvider;
+			MetricsConfig m_metrics;
+			AdmissionConfig m_admission;
+			LocalShmConfig m_localShm;
+			TraceConfig m_trace;
+		};
+	}
+}
@@ -0,0 +1,125 @@
+#include "CachedIasConnector.h"
+
+#include <cstring>
+
+using namespace Decent;
+using namespace Decent::ServerApp;
+
+namespace
+{
+	//Expired entries are only swept once the cache grows beyond this, since there are only a few GIDs in practice.
+	static constexpr size_t gsk_sweepThreshold = 1024;
+
+	static uint32_t GidToKey(const sgx_epid_group_id_t& gid)
+	{
+		uint32_t key = 0;
+		static_assert(sizeof(key) == sizeof(sgx_epid_group_id_t), "Unexpected size of EPID group ID.");
+		std::memcpy(&key, gid, sizeof(key));
+		return key;
+	}
+}
+
+CachedIasConnector::CachedIasConnector(std::shared_ptr<Ias::Connector> upstream, const std::string & subscriptionKey, std::chrono::seconds sigRlTtl) :
+	Ias::Connector(subscriptionKey),
+	m_upstream(upstream),
+	m_sigRlTtl(sigRlTtl),
+	m_sigRlMutex(),
+	m_sigRlCache(),
+	m_hitCount(0),
+	m_missCount(0),
+	m_coalescedCount(0)
+{
+}
+
+CachedIasConnector::~CachedIasConnector()
+{
+}
+
+std::string CachedIasConnector::GetSigRl(const sgx_epid_group_id_t & gid) const
+{
+	const uint32_t key = GidToKey(gid);
+
+	std::promise<std::string> fetchPromise;
+	std::shared_future<std::string> result;
+	{
+		std::unique_lock<std::mutex> cacheLock(m_sigRlMutex);
+		const Clock::time_point now = Clock::now();
+
+		auto it = m_sigRlCache.find(key);
+		if (it != m_sigRlCache.end())
+		{
+			const SigRlEntry& entry = it->second;
+			if (entry.m_hasValue && now < entry.m_expire)
+			{
+				++m_hitCount;
+				return entry.m_sigRl;
+			}
+			if (entry.m_inFlight.valid())
+			{
+				++m_coalescedCount;
+				result = entry.m_inFlight;
+			}
+		}
+
+		if (!result.valid())
+		{
+			if (m_sigRlCache.size() >= gsk_sweepThreshold)
+			{
+				DropExpired(now);
+			}
+
+			++m_missCount;
+			m_sigRlCache[key].m_inFlight = fetchPromise.get_future().share();
+			cacheLock.unlock();
+
+			//We are the one fetching from upstream.
+			std::string sigRl;
+			try
+			{
+				sigRl = m_upstream->GetSigRl(gid);
+			}
+			catch (...)
+			{
+				cacheLock.lock();
+				m_sigRlCache[key].m_inFlight = std::shared_future<std::string>();
+				cacheLock.unlock();
+
+				fetchPromise.set_exception(std::current_exception());
+				throw;
+			}
+
+			cacheLock.lock();
+			SigRlEntry& entry = m_sigRlCache[key];
+			entry.m_hasValue = true;
+			entry.m_sigRl = sigRl;
+			entry.m_expire = Clock::now() + m_sigRlTtl;
+			entry.m_inFlight = std::shared_future<std::string>();
+			cacheLock.unlock();
+
+			fetchPromise.set_value(sigRl);
+			return sigRl;
+		}
+	}
+
+	return result.get();
+}
+
+void CachedIasConnector::GetQuoteReport(const std::string & jsonReqBody, std::string & outReport, std::string & outSign, std::string & outCert) const
+{
+	m_upstream->GetQuoteReport(jsonReqBody, outReport, outSign, outCert);
+}
+
+void CachedIasConnector::DropExpired(Clock::time_point now) const
+{
+	for (auto it = m_sigRlCache.begin(); it != m_sigRlCache.end(); )
+	{
+		if (!it->second.m_inFlight.valid() && !(it->second.m_hasValue && now < it->second.m_expire))
+		{
+			it = m_sigRlCache.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <chrono>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <unordered_map>
+
+#include <sgx_quote.h>
+
+#include <DecentApi/CommonApp/SGX/IasConnector.h>
+
+namespace Decent
+{
+	namespace ServerApp
+	{
+		/**
+		 * \brief	An IAS connector that caches signature revocation lists per EPID group. Concurrent
+		 * 			requests for a GID that is being fetched wait for the same upstream call, instead of
+		 * 			issuing their own. Report requests are passed to the upstream connector as they are.
+		 */
+		class CachedIasConnector : public Ias::Connector
+		{
+		public:
+			/**
+			 * \brief	Constructor
+			 *
+			 * \param	upstream	   	The connector that actually talks to IAS.
+			 * \param	subscriptionKey	The IAS subscription key (only used by the base class).
+			 * \param	sigRlTtl	   	How long a SigRL is served from cache.
+			 */
+			CachedIasConnector(std::shared_ptr<Ias::Connector> upstream, const std::string& subscriptionKey,
+				std::chrono::seconds sigRlTtl);
+
+			virtual ~CachedIasConnector();
+
+			virtual std::string GetSigRl(const sgx_epid_group_id_t& gid) const override;
+
+			virtual void GetQuoteReport(const std::string& jsonReqBody, std::string& outReport, std::string& outSign, std::string& outCert) const override;
+
+			uint64_t GetHitCount() const noexcept { return m_hitCount; }
+
+			uint64_t GetMissCount() const noexcept { return m_missCount; }
+
+			/** \brief	Number of requests that joined an in-flight upstream call. */
+			uint64_t GetCoalescedCount() const noexcept { return m_coalescedCount; }
+
+		private:
+			typedef std::chrono::steady_clock Clock;
+
+			struct SigRlEntry
+			{
+				bool m_hasValue = false;
+				std::string m_sigRl;
+				Clock::time_point m_expire;
+				std::shared_future<std::string> m_inFlight;
+			};
+
+			void DropExpired(Clock::time_point now) const;
+
+			std::shared_ptr<Ias::Connector> m_upstream;
+			const Clock::duration m_sigRlTtl;
+
+			mutable std::mutex m_sigRlMutex;
+			mutable std::unordered_map<uint32_t, SigRlEntry> m_sigRlCache;
+
+			mutable std::atomic<uint64_t> m_hitCount;
+			mutable std::atomic<uint64_t> m_missCount;
+			mutable std::atomic<uint64_t> m_coalescedCount;
+		};
+	}
+}
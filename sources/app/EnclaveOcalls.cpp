@@ -0,0 +1,9 @@
+#include <cstdint>
+
+#include "Enclave_u.h"
+
+/* OCALLs declared in Enclave.edl. */
+
+extern "C" void ocall_decent_server_bench_nop()
+{
+}
@@ -0,0 +1,426 @@
+#include "EpollTcpServer.h"
+
+#include <stdexcept>
+
+#ifdef __linux__
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/epoll.h>
+#	include <sys/ioctl.h>
+#	include <sys/socket.h>
+#	include <sys/eventfd.h>
+#	include <netinet/in.h>
+#	include <netinet/tcp.h>
+#endif // __linux__
+
+using namespace Decent;
+using namespace Decent::ServerApp;
+
+constexpr size_t EpollTcpServer::sk_maxPeekSize;
+constexpr int64_t EpollTcpServer::sk_firstMsgTimeout;
+
+#ifdef __linux__
+
+namespace
+{
+	static constexpr int gsk_maxEvents = 64;
+	static constexpr int gsk_listenBacklog = 1024;
+	//How often (in milliseconds) the acceptors look for overdue connections.
+	static constexpr int gsk_sweepInterval = 1000;
+
+	static bool SetNonBlocking(int socket, bool isNonBlocking) noexcept
+	{
+		const int flags = fcntl(socket, F_GETFL, 0);
+		if (flags < 0)
+		{
+			return false;
+		}
+		return fcntl(socket, F_SETFL, isNonBlocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK)) == 0;
+	}
+
+	static int OpenListenSocket(uint32_t ipAddr, uint16_t portNum)
+	{
+		const int listenSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (listenSocket < 0)
+		{
+			throw std::runtime_error("Failed to create the listening socket.");
+		}
+
+		const int enable = 1;
+		sockaddr_in addr = {};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(ipAddr);
+		addr.sin_port = htons(portNum);
+		if (setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) != 0 ||
+			setsockopt(listenSocket, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) != 0 ||
+			bind(listenSocket, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 ||
+			listen(listenSocket, gsk_listenBacklog) != 0)
+		{
+			close(listenSocket);
+			throw std::runtime_error("Failed to bind the listening socket to port " + std::to_string(portNum) + ".");
+		}
+		return listenSocket;
+	}
+}
+
+EpollTcpConnection::EpollTcpConnection(int socket) :
+	m_socket(socket)
+{
+}
+
+EpollTcpConnection::~EpollTcpConnection()
+{
+	close(m_socket);
+}
+
+size_t EpollTcpConnection::SendRaw(const void * const dataPtr, const size_t size)
+{
+	while (true)
+	{
+		const ssize_t sentSize = send(m_socket, dataPtr, size, MSG_NOSIGNAL);
+		if (sentSize >= 0)
+		{
+			return static_cast<size_t>(sentSize);
+		}
+		if (errno != EINTR)
+		{
+			throw std::runtime_error("Failed to send to the TCP connection.");
+		}
+	}
+}
+
+size_t EpollTcpConnection::RecvRaw(void * const bufPtr, const size_t size)
+{
+	while (true)
+	{
+		const ssize_t recvSize = recv(m_socket, bufPtr, size, 0);
+		if (recvSize > 0)
+		{
+			return static_cast<size_t>(recvSize);
+		}
+		if (recvSize == 0)
+		{
+			throw std::runtime_error("The TCP connection is closed by the peer.");
+		}
+		if (errno != EINTR)
+		{
+			throw std::runtime_error("Failed to receive from the TCP connection.");
+		}
+	}
+}
+
+void EpollTcpConnection::Terminate() noexcept
+{
+	shutdown(m_socket, SHUT_RDWR);
+}
+
+EpollTcpServer::EpollTcpServer(uint32_t ipAddr, uint16_t portNum, size_t acceptors) :
+	m_acceptors(),
+	m_readyMutex(),
+	m_readySignal(),
+	m_readySockets(),
+	m_isTerminated(false)
+{
+	try
+	{
+		for (size_t i = 0; i < std::max<size_t>(acceptors, 1); ++i)
+		{
+			std::unique_ptr<Acceptor> acceptor(new Acceptor{ -1, -1, -1, std::thread(), {} });
+			m_acceptors.push_back(std::move(acceptor));
+			Acceptor& ref = *m_acceptors.back();
+
+			ref.m_listenSocket = OpenListenSocket(ipAddr, portNum);
+			ref.m_epoll = epoll_create1(EPOLL_CLOEXEC);
+			ref.m_wakeEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if (ref.m_epoll < 0 || ref.m_wakeEvent < 0)
+			{
+				throw std::runtime_error("Failed to create epoll instance.");
+			}
+
+			epoll_event listenEvent = {};
+			listenEvent.events = EPOLLIN;
+			listenEvent.data.fd = ref.m_listenSocket;
+			epoll_event wakeEvent = {};
+			wakeEvent.events = EPOLLIN;
+			wakeEvent.data.fd = ref.m_wakeEvent;
+			if (epoll_ctl(ref.m_epoll, EPOLL_CTL_ADD, ref.m_listenSocket, &listenEvent) != 0 ||
+				epoll_ctl(ref.m_epoll, EPOLL_CTL_ADD, ref.m_wakeEvent, &wakeEvent) != 0)
+			{
+				throw std::runtime_error("Failed to watch the listening socket.");
+			}
+		}
+	}
+	catch (...)
+	{
+		CloseAll();
+		throw;
+	}
+
+	for (std::unique_ptr<Acceptor>& acceptor : m_acceptors)
+	{
+		acceptor->m_thread = std::thread(&EpollTcpServer::AcceptorWorker, this, std::ref(*acceptor));
+	}
+}
+
+EpollTcpServer::~EpollTcpServer()
+{
+	Terminate();
+	for (std::unique_ptr<Acceptor>& acceptor : m_acceptors)
+	{
+		if (acceptor->m_thread.joinable())
+		{
+			acceptor->m_thread.join();
+		}
+	}
+	CloseAll();
+}
+
+std::unique_ptr<Net::ConnectionBase> EpollTcpServer::AcceptConnection()
+{
+	std::unique_lock<std::mutex> readyLock(m_readyMutex);
+	m_readySignal.wait(readyLock, [this]() { return m_isTerminated || m_readySockets.size() > 0; });
+	if (m_isTerminated)
+	{
+		return nullptr;
+	}
+
+	const int socket = m_readySockets.front();
+	m_readySockets.pop_front();
+	readyLock.unlock();
+
+	return std::unique_ptr<Net::ConnectionBase>(new EpollTcpConnection(socket));
+}
+
+bool EpollTcpServer::IsTerminated() const noexcept
+{
+	return m_isTerminated;
+}
+
+void EpollTcpServer::Terminate() noexcept
+{
+	if (m_isTerminated.exchange(true))
+	{
+		return;
+	}
+
+	for (std::unique_ptr<Acceptor>& acceptor : m_acceptors)
+	{
+		const uint64_t one = 1;
+		if (acceptor->m_wakeEvent >= 0 && write(acceptor->m_wakeEvent, &one, sizeof(one)) < 0)
+		{
+			//The acceptor is woken by the next event anyway.
+		}
+	}
+
+	std::unique_lock<std::mutex> readyLock(m_readyMutex);
+	m_readySignal.notify_all();
+}
+
+void EpollTcpServer::AcceptorWorker(Acceptor & acceptor)
+{
+	epoll_event events[gsk_maxEvents];
+	auto nextSweep = std::chrono::steady_clock::now() + std::chrono::milliseconds(gsk_sweepInterval);
+	while (!m_isTerminated)
+	{
+		const int eventNum = epoll_wait(acceptor.m_epoll, events, gsk_maxEvents, gsk_sweepInterval);
+		if (eventNum < 0 && errno != EINTR)
+		{
+			return;
+		}
+
+		if (std::chrono::steady_clock::now() >= nextSweep)
+		{
+			CloseOverdue(acceptor);
+			nextSweep = std::chrono::steady_clock::now() + std::chrono::milliseconds(gsk_sweepInterval);
+		}
+
+		for (int i = 0; i < eventNum && !m_isTerminated; ++i)
+		{
+			const int fd = events[i].data.fd;
+			if (fd == acceptor.m_wakeEvent)
+			{
+				continue;
+			}
+
+			if (fd == acceptor.m_listenSocket)
+			{
+				int socket = -1;
+				while ((socket = accept4(acceptor.m_listenSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+				{
+					const int enable = 1;
+					setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+					epoll_event cntEvent = {};
+					cntEvent.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+					cntEvent.data.fd = socket;
+					if (epoll_ctl(acceptor.m_epoll, EPOLL_CTL_ADD, socket, &cntEvent) != 0)
+					{
+						close(socket);
+						continue;
+					}
+					acceptor.m_watched[socket] = std::chrono::steady_clock::now() + std::chrono::seconds(sk_firstMsgTimeout);
+				}
+				continue;
+			}
+
+			//A connection with data (or closed); it's watched in one-shot mode, so it's only here once.
+			switch (CheckMessageReady(fd))
+			{
+			case 1:
+				epoll_ctl(acceptor.m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+				acceptor.m_watched.erase(fd);
+				if (!SetNonBlocking(fd, false))
+				{
+					close(fd);
+					break;
+				}
+				{
+					std::unique_lock<std::mutex> readyLock(m_readyMutex);
+					m_readySockets.push_back(fd);
+				}
+				m_readySignal.notify_one();
+				break;
+			case 0:
+			{
+				epoll_event cntEvent = {};
+				cntEvent.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+				cntEvent.data.fd = fd;
+				if (epoll_ctl(acceptor.m_epoll, EPOLL_CTL_MOD, fd, &cntEvent) != 0)
+				{
+					acceptor.m_watched.erase(fd);
+					close(fd);
+				}
+				break;
+			}
+			default:
+				epoll_ctl(acceptor.m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+				acceptor.m_watched.erase(fd);
+				close(fd);
+				break;
+			}
+		}
+	}
+}
+
+void EpollTcpServer::CloseOverdue(Acceptor & acceptor) noexcept
+{
+	const auto now = std::chrono::steady_clock::now();
+	for (auto it = acceptor.m_watched.begin(); it != acceptor.m_watched.end(); )
+	{
+		if (it->second > now)
+		{
+			++it;
+			continue;
+		}
+		epoll_ctl(acceptor.m_epoll, EPOLL_CTL_DEL, it->first, nullptr);
+		close(it->first);
+		it = acceptor.m_watched.erase(it);
+	}
+}
+
+int EpollTcpServer::CheckMessageReady(int socket) noexcept
+{
+	uint64_t msgSize = 0;
+	const ssize_t peekSize = recv(socket, &msgSize, sizeof(msgSize), MSG_PEEK | MSG_DONTWAIT);
+	if (peekSize == 0)
+	{
+		return -1;
+	}
+	if (peekSize < 0)
+	{
+		return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+	}
+	if (static_cast<size_t>(peekSize) < sizeof(msgSize))
+	{
+		return 0;
+	}
+
+	int availSize = 0;
+	if (ioctl(socket, FIONREAD, &availSize) != 0)
+	{
+		return -1;
+	}
+	const uint64_t needed = msgSize > sk_maxPeekSize ? sk_maxPeekSize : (sizeof(msgSize) + msgSize);
+	return static_cast<uint64_t>(availSize) >= needed ? 1 : 0;
+}
+
+void EpollTcpServer::CloseAll() noexcept
+{
+	for (std::unique_ptr<Acceptor>& acceptor : m_acceptors)
+	{
+		for (int fd : { acceptor->m_listenSocket, acceptor->m_epoll, acceptor->m_wakeEvent })
+		{
+			if (fd >= 0)
+			{
+				close(fd);
+			}
+		}
+		acceptor->m_listenSocket = acceptor->m_epoll = acceptor->m_wakeEvent = -1;
+
+		//Closing the epoll instance doesn't close the sockets it watches.
+		for (const auto& watched : acceptor->m_watched)
+		{
+			close(watched.first);
+		}
+		acceptor->m_watched.clear();
+	}
+
+	std::unique_lock<std::mutex> readyLock(m_readyMutex);
+	for (int socket : m_readySockets)
+	{
+		close(socket);
+	}
+	m_readySockets.clear();
+}
+
+#else
+
+EpollTcpConnection::EpollTcpConnection(int socket) :
+	m_socket(socket)
+{
+	throw std::runtime_error("The epoll TCP server is only supported on Linux.");
+}
+
+EpollTcpConnection::~EpollTcpConnection()
+{
+}
+
+size_t EpollTcpConnection::SendRaw(const void * const dataPtr, const size_t size)
+{
+	throw std::runtime_error("The epoll TCP server is only supported on Linux.");
+}
+
+size_t EpollTcpConnection::RecvRaw(void * const bufPtr, const size_t size)
+{
+	throw std::runtime_error("The epoll TCP server is only supported on Linux.");
+}
+
+void EpollTcpConnection::Terminate() noexcept
+{
+}
+
+EpollTcpServer::EpollTcpServer(uint32_t ipAddr, uint16_t portNum, size_t acceptors) :
+	m_isTerminated(true)
+{
+	throw std::runtime_error("The epoll TCP server is only supported on Linux.");
+}
+
+EpollTcpServer::~EpollTcpServer()
+{
+}
+
+std::unique_ptr<Net::ConnectionBase> EpollTcpServer::AcceptConnection()
+{
+	return nullptr;
+}
+
+bool EpollTcpServer::IsTerminated() const noexcept
+{
+	return true;
+}
+
+void EpollTcpServer::Terminate() noexcept
+{
+}
+
+#endif // __linux__
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <condition_variable>
+
+#include <DecentApi/CommonApp/Net/Server.h>
+
+namespace Decent
+{
+	namespace ServerApp
+	{
+		/**
+		 * \brief	A TCP connection on a socket accepted by EpollTcpServer. The socket is blocking, like
+		 * 			the ones of Net::TCPServer, once it's handed to a worker.
+		 */
+		class EpollTcpConnection : public Net::ConnectionBase
+		{
+		public:
+			/**
+			 * \brief	Constructor
+			 *
+			 * \param	socket	The socket; it's closed by this connection.
+			 */
+			EpollTcpConnection(int socket);
+
+			EpollTcpConnection(const EpollTcpConnection& rhs) = delete;
+
+			virtual ~EpollTcpConnection();
+
+			virtual size_t SendRaw(const void* const dataPtr, const size_t size) override;
+
+			virtual size_t RecvRaw(void* const bufPtr, const size_t size) override;
+
+			virtual void Terminate() noexcept override;
+
+		private:
+			int m_socket;
+		};
+
+		/**
+		 * \brief	A readiness-based TCP server (Linux only). Several acceptor threads, each with its own
+		 * 			listening socket bound to the same port (SO_REUSEPORT) and its own epoll instance,
+		 * 			accept connections and watch them. A connection is only returned by
+		 * 			AcceptConnection() once its first message (an 8-byte length followed by the data) has
+		 * 			fully arrived, so slow or idle clients never hold a worker. A connection whose first
+		 * 			message hasn't arrived within sk_firstMsgTimeout is closed, so they don't hold file
+		 * 			descriptors forever either.
+		 */
+		class EpollTcpServer : public Net::Server
+		{
+		public:
+			/**
+			 * \brief	A message larger than this is handed over once this many bytes have arrived,
+			 * 			since it may never fit into the socket's receive buffer as a whole.
+			 */
+			static constexpr size_t sk_maxPeekSize = 64 * 1024;
+
+			/** \brief	How long (in seconds) a new connection may take to send its first message. */
+			static constexpr int64_t sk_firstMsgTimeout = 10;
+
+		public:
+			/**
+			 * \brief	Constructor. The acceptor threads are started here.
+			 *
+			 * \exception	std::runtime_error	Thrown if the sockets can't be set up, or on other platforms.
+			 *
+			 * \param	ipAddr	 	The IP address, in host byte order.
+			 * \param	portNum  	The port number.
+			 * \param	acceptors	Number of acceptor threads.
+			 */
+			EpollTcpServer(uint32_t ipAddr, uint16_t portNum, size_t acceptors);
+
+			virtual ~EpollTcpServer();
+
+			/**
+			 * \brief	Waits for a connection whose first message has arrived.
+			 *
+			 * \return	The connection, or nullptr if the server is terminated.
+			 */
+			virtual std::unique_ptr<Net::ConnectionBase> AcceptConnection() override;
+
+			virtual bool IsTerminated() const noexcept override;
+
+			virtual void Terminate() noexcept override;
+
+		private:
+			struct Acceptor
+			{
+				int m_listenSocket;
+				int m_epoll;
+				int m_wakeEvent;
+				std::thread m_thread;
+
+				//Sockets being watched, to the deadline of their first message; only used by the
+				//acceptor thread, and by CloseAll once it's stopped.
+				std::map<int, std::chrono::steady_clock::time_point> m_watched;
+			};
+
+			void AcceptorWorker(Acceptor& acceptor);
+
+			/** \brief	Closes the watched sockets whose first message is overdue. */
+			static void CloseOverdue(Acceptor& acceptor) noexcept;
+
+			/**
+			 * \brief	Checks the data arrived on a socket.
+			 *
+			 * \param	socket	The socket.
+			 *
+			 * \return	1 if a whole message has arrived, 0 if it needs to wait more, -1 if the socket is
+			 * 			closed or broken.
+			 */
+			static int CheckMessageReady(int socket) noexcept;
+
+			void CloseAll() noexcept;
+
+			std::vector<std::unique_ptr<Acceptor> > m_acceptors;
+
+			std::mutex m_readyMutex;
+			std::condition_variable m_readySignal;
+			std::deque<int> m_readySockets;
+
+			std::atomic<bool> m_isTerminated;
+		};
+	}
+}
@@ -0,0 +1,140 @@
+#include "FrontEndHandler.h"
+
+#include <chrono>
+
+#include <DecentApi/Common/Net/ConnectionBase.h>
+
+#include "../CommonApp/Tracer.h"
+
+#include "ServerMetrics.h"
+#include "TrackedServer.h"
+#include "AdmissionController.h"
+
+using namespace Decent;
+using namespace Decent::ServerApp;
+using namespace Decent::Perf;
+
+constexpr char const FrontEndHandler::sk_catStats[];
+constexpr char const FrontEndHandler::sk_statsFmtJson[];
+constexpr char const FrontEndHandler::sk_statsFmtPrometheus[];
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	static uint64_t ToUs(Clock::duration duration)
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+	}
+
+	/** \brief	Keeps the busy worker count while a worker is handling a message. */
+	class BusyWorkerGuard
+	{
+	public:
+		BusyWorkerGuard(std::atomic<uint64_t>& busyWorkers) :
+			m_busyWorkers(busyWorkers)
+		{
+			m_busyWorkers.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		~BusyWorkerGuard()
+		{
+			m_busyWorkers.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+	private:
+		std::atomic<uint64_t>& m_busyWorkers;
+	};
+}
+
+FrontEndHandler::FrontEndHandler(std::shared_ptr<Net::ConnectionHandler> enclave, std::shared_ptr<ServerMetrics> metrics, bool isStatsEnabled) :
+	m_enclave(enclave),
+	m_metrics(metrics),
+	m_isStatsEnabled(isStatsEnabled)
+{
+}
+
+FrontEndHandler::~FrontEndHandler()
+{
+}
+
+bool FrontEndHandler::ProcessSmartMessage(const std::string & category, Net::ConnectionBase & connection, Net::ConnectionBase *& freeHeldCnt)
+{
+	const Clock::time_point start = Clock::now();
+
+	//RTTI is off in release builds; TrackedServer is the only server the handler is used with.
+	TrackedConnection& trackedCnt = static_cast<TrackedConnection&>(connection);
+	AdmissionController* admission = trackedCnt.GetAdmission();
+
+	//Spans recorded on this thread while the message is handled (e.g. IAS requests) belong to the connection.
+	TraceIdScope traceIdScope(trackedCnt.GetTraceId());
+	TraceSpan handleSpan("Handle");
+
+	if (trackedCnt.TakeFirstMessage())
+	{
+		m_metrics->m_queueWait.Record(ToUs(start - trackedCnt.GetAcceptTime()));
+		if (Tracer::GetInstance().IsEnabled())
+		{
+			Tracer::GetInstance().Record("QueueWait", Tracer::FromSteady(trackedCnt.GetAcceptTime()), Tracer::FromSteady(start),
+				trackedCnt.GetTraceId());
+		}
+
+		//The client would give up before the handshake is done; don't waste IAS and enclave time on it.
+		if (admission && !admission->IsInTime(trackedCnt.GetAcceptTime(), start))
+		{
+			trackedCnt.LeaveAdmission();
+			admission->RejectConnection(connection);
+			return false;
+		}
+	}
+
+	if (m_isStatsEnabled && category == sk_catStats)
+	{
+		ProcessStats(connection);
+		return false;
+	}
+
+	BusyWorkerGuard busyGuard(m_metrics->m_busyWorkers);
+	ServerMetrics::TakeThreadIasTime();
+
+	bool isHeld = false;
+	try
+	{
+		isHeld = m_enclave->ProcessSmartMessage(category, connection, freeHeldCnt);
+	}
+	catch (...)
+	{
+		trackedCnt.LeaveAdmission();
+		m_metrics->m_failedCnt.fetch_add(1, std::memory_order_relaxed);
+		throw;
+	}
+	trackedCnt.LeaveAdmission();
+
+	const Clock::duration handlerDuration = Clock::now() - start;
+	if (admission)
+	{
+		admission->RecordService(handlerDuration);
+	}
+
+	const uint64_t handlerTime = ToUs(handlerDuration);
+	const uint64_t iasTime = ServerMetrics::TakeThreadIasTime();
+	m_metrics->m_handler.Record(handlerTime);
+	m_metrics->m_handlerExclIas.Record(handlerTime > iasTime ? handlerTime - iasTime : 0);
+	m_metrics->m_handledCnt.fetch_add(1, std::memory_order_relaxed);
+
+	return isHeld;
+}
+
+void FrontEndHandler::ProcessStats(Net::ConnectionBase & connection)
+{
+	const std::string format = connection.RecvContainer<std::string>();
+
+	if (format == sk_statsFmtPrometheus)
+	{
+		connection.SendContainer(m_metrics->ToPrometheus());
+	}
+	else
+	{
+		connection.SendContainer(m_metrics->ToJson());
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <memory>
+
+#include <DecentApi/Common/Net/ConnectionHandler.h>
+
+namespace Decent
+{
+	namespace ServerApp
+	{
+		class ServerMetrics;
+
+		/**
+		 * \brief	The connection handler given to the smart server. It measures the messages passed to
+		 * 			the enclave, and answers the "Stats" category, if it's enabled, by itself.
+		 *
+		 * 			Connections must come from a TrackedServer.
+		 */
+		class FrontEndHandler : public Net::ConnectionHandler
+		{
+		public:
+			static constexpr char const sk_catStats[] = "Stats";
+
+			static constexpr char const sk_statsFmtJson[] = "json";
+			static constexpr char const sk_statsFmtPrometheus[] = "prometheus";
+
+		public:
+			/**
+			 * \brief	Constructor
+			 *
+			 * \param	enclave		  	The handler of all other categories, i.e. the enclave.
+			 * \param	metrics		  	The metrics to update.
+			 * \param	isStatsEnabled	True to answer "Stats" messages. It should only be turned on for
+			 * 							the local server, since the metrics are not meant to be public.
+			 */
+			FrontEndHandler(std::shared_ptr<Net::ConnectionHandler> enclave, std::shared_ptr<ServerMetrics> metrics, bool isStatsEnabled);
+
+			virtual ~FrontEndHandler();
+
+			virtual bool ProcessSmartMessage(const std::string& category, Net::ConnectionBase& connection, Net::ConnectionBase*& freeHeldCnt) override;
+
+		private:
+			/**
+			 * \brief	Answers a "Stats" message. The request is one message carrying the format ("json",
+			 * 			the default if empty, or "prometheus"), and the reply is one message carrying the
+			 * 			metrics in that format.
+			 *
+			 * \param [in,out]	connection	The connection.
+			 */
+			void ProcessStats(Net::ConnectionBase& connection);
+
+			std::shared_ptr<Net::ConnectionHandler> m_enclave;
+			std::shared_ptr<ServerMetrics> m_metrics;
+			const bool m_isStatsEnabled;
+		};
+	}
+}
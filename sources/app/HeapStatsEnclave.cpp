@@ -0,0 +1,19 @@
+#include "HeapStatsEnclave.h"
+
+#include <stdexcept>
+
+#include "Enclave_u.h"
+
+using namespace Decent;
+using namespace Decent::ServerApp;
+
+EnclaveHeapStats ServerApp::GetEnclaveHeapStats(sgx_enclave_id_t enclaveId)
+{
+	EnclaveHeapStats stats = { 0, 0, 0, 0, 0, 0 };
+	if (ecall_decent_server_heap_stats(enclaveId, &stats.m_inUse, &stats.m_peakInUse, &stats.m_reserved,
+		&stats.m_peakReserved, &stats.m_failedCnt, &stats.m_peakStack) != SGX_SUCCESS)
+	{
+		throw std::runtime_error("Failed to get heap stats of the enclave.");
+	}
+	return stats;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+#include <sgx_urts.h>
+
+namespace Decent
+{
+	namespace ServerApp
+	{
+		/** \brief	Heap and stack usage inside the enclave, in bytes. */
+		struct EnclaveHeapStats
+		{
+			uint64_t m_inUse;        //Bytes of live objects.
+			uint64_t m_peakInUse;
+			uint64_t m_reserved;     //Bytes taken from the enclave heap, including the free blocks pooled.
+			uint64_t m_peakReserved; //The high-water mark to size HeapMaxSize with.
+			uint64_t m_failedCnt;    //Allocations failed because the enclave heap is exhausted.
+			uint64_t m_peakStack;    //A lower bound of the deepest stack; StackMaxSize needs a margin above it.
+		};
+
+		/**
+		 * \brief	Gets the heap and stack usage of the enclave.
+		 *
+		 * \exception	std::runtime_error	Thrown if the ECALL fails.
+		 *
+		 * \param	enclaveId	The enclave ID.
+		 *
+		 * \return	The usage.
+		 */
+		EnclaveHeapStats GetEnclaveHeapStats(sgx_enclave_id_t enclaveId);
+	}
+}
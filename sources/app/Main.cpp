@@ -1,6 +1,10 @@
 #include <string>
+#include <chrono>
+#include <future>
 #include <memory>
+#include <thread>
 #include <iostream>
+#include <algorithm>
 
 #include <tclap/CmdLine.h>
 #include <boost/filesystem/path.hpp>
@@ -22,12 +26,31 @@
 #include <DecentApi/CommonApp/Threading/MainThreadAsynWorker.h>
 
 #include <DecentApi/Common/Common.h>
+#include <DecentApi/Common/Net/ConnectionPoolBase.h>
 #include <DecentApi/Common/Ra/WhiteList/WhiteList.h>
 #include <DecentApi/Common/MbedTls/Initializer.h>
 
 #include <DecentApi/DecentServerApp/SGX/DecentServerConfig.h>
 #include <DecentApi/DecentServerApp/DecentServer.h>
 
+#include "AppConfig.h"
+#include "CachedIasConnector.h"
+#include "MeteredIasConnector.h"
+#include "PooledIasConnector.h"
+#include "SwitchlessEnclave.h"
+#include "ServerMetrics.h"
+#include "TrackedServer.h"
+#include "FrontEndHandler.h"
+#include "MetricsDumper.h"
+#include "StartupTimeline.h"
+#include "HeapStatsEnclave.h"
+#include "EpollTcpServer.h"
+#include "AdmissionController.h"
+#include "ThrottledIasConnector.h"
+#include "ShmRingServer.h"
+
+#include "../CommonApp/Tracer.h"
+
 #define DECENT_SERVER_VERSION_MAIN 0
 #define DECENT_SERVER_VERSION_SUB  13
 
@@ -40,6 +63,15 @@ using namespace Decent;
 using namespace Decent::Tools;
 using namespace Decent::Threading;
 
+namespace
+{
+	/**
+	 * \brief	TCSs kept away from the workers, for the ECALLs made by other threads; that is, the
+	 * 			metrics dumper getting the heap stats of the enclave.
+	 */
+	static constexpr size_t gsk_reservedTcsNum = 1;
+}
+
 /**
  * \brief	Main entry-point for this application
  *
@@ -69,16 +101,23 @@ int main(int argc, char ** argv)
 
 	cmd.parse(argc, argv);
 
+	//Independent startup phases run concurrently; how long each one takes is logged once the servers are up.
+	ServerApp::StartupTimeline startupTimeline;
+
 	//------- Read configuration file:
 	std::unique_ptr<Sgx::DecentServerConfig> serverConfig;
+	std::unique_ptr<ServerApp::AppConfig> appConfig;
 	try
 	{
+		ServerApp::StartupTimeline::Phase phase(startupTimeline, "Configuration");
+
 		std::string configJsonStr;
 		DiskFile file(configPathArg.getValue(), FileBase::Mode::Read, true);
 		configJsonStr.resize(file.GetFileSize());
 		file.ReadBlockExactSize(configJsonStr);
 
 		serverConfig = std::make_unique<Sgx::DecentServerConfig>(configJsonStr);
+		appConfig = std::make_unique<ServerApp::AppConfig>(configJsonStr);
 	}
 	catch (const std::exception& e)
 	{
@@ -104,39 +143,136 @@ int main(int argc, char ** argv)
 		return -1;
 	}
 
-	//------- Setup TCP server:
-	std::unique_ptr<Net::Server> tcpServer;
-	try
+	std::shared_ptr<ServerApp::ServerMetrics> metrics = std::make_shared<ServerApp::ServerMetrics>();
+
+	//------- Setup tracing:
+	const auto& traceConfig = appConfig->GetTraceConfig();
+	if (traceConfig.GetFile().size() > 0)
 	{
-		tcpServer = std::make_unique<Net::TCPServer>(serverIp, serverPort);
+		try
+		{
+			Perf::Tracer::GetInstance().Start(traceConfig.GetFile(), "DecentServer", traceConfig.GetBufferSize(),
+				std::chrono::milliseconds(std::max<uint64_t>(traceConfig.GetFlushInterval(), 1)));
+			PRINT_I("Tracing to %s.", traceConfig.GetFile().c_str());
+		}
+		catch (const std::exception& e)
+		{
+			PRINT_W("Failed to start tracing. Error Msg: %s", e.what());
+		}
 	}
-	catch (const std::exception& e)
+
+	//------- Setup admission control of the TCP server:
+	const auto& admissionConfig = appConfig->GetAdmissionConfig();
+	std::shared_ptr<ServerApp::AdmissionController> admission;
+	if (admissionConfig.IsEnabled())
 	{
-		PRINT_W("Failed to start TCP server. Error Message: %s", e.what());
+		admission = std::make_shared<ServerApp::AdmissionController>(admissionConfig.GetMaxInSystem(),
+			std::chrono::milliseconds(admissionConfig.GetDeadline()), metrics);
 	}
 
-	//------- Setup Local server:
+	//------- Setup TCP server and Local server:
+	//Sockets are opened while the enclave is being loaded; they are checked once the enclave is ready.
+	std::unique_ptr<Net::Server> tcpServer;
 	std::unique_ptr<Net::Server> localServer;
-	try
-	{
-		localServer = std::make_unique<Net::LocalServer>(localServerName);
-	}
-	catch (const std::exception& e)
+	std::unique_ptr<Net::Server> shmServer;
+	std::future<void> serversSetup = std::async(std::launch::async,
+		[&startupTimeline, &tcpServer, &localServer, &shmServer, &metrics, &admission, &appConfig, serverIp, serverPort, &localServerName]()
 	{
-		PRINT_W("Failed to start local server. Error Message: %s", e.what());
-	}
+		ServerApp::StartupTimeline::Phase phase(startupTimeline, "Servers");
+		try
+		{
+			const auto& frontEndConfig = appConfig->GetFrontEndConfig();
+			std::unique_ptr<Net::Server> rawTcpServer;
+			if (frontEndConfig.IsEpollTcpServer())
+			{
+				rawTcpServer = std::make_unique<ServerApp::EpollTcpServer>(serverIp, serverPort, frontEndConfig.GetTcpAcceptors());
+			}
+			else
+			{
+				rawTcpServer = std::make_unique<Net::TCPServer>(serverIp, serverPort);
+			}
+			tcpServer = std::make_unique<ServerApp::TrackedServer>(std::move(rawTcpServer), metrics, admission);
+		}
+		catch (const std::exception& e)
+		{
+			PRINT_W("Failed to start TCP server. Error Message: %s", e.what());
+		}
 
-	if (!tcpServer && !localServer)
-	{
-		PRINT_W("Failed to start all servers. Program will be terminated!");
-		return -1;
-	}
+		try
+		{
+			localServer = std::make_unique<ServerApp::TrackedServer>(
+				std::make_unique<Net::LocalServer>(localServerName), metrics, nullptr);
+		}
+		catch (const std::exception& e)
+		{
+			PRINT_W("Failed to start local server. Error Message: %s", e.what());
+		}
+
+		//Clients on this host try it first, under the same name as the local server.
+		const auto& localShmConfig = appConfig->GetLocalShmConfig();
+		if (localShmConfig.IsEnabled())
+		{
+			try
+			{
+				shmServer = std::make_unique<ServerApp::TrackedServer>(
+					std::make_unique<ServerApp::ShmRingServer>(localServerName, localShmConfig.GetRingSize()), metrics, nullptr);
+			}
+			catch (const std::exception& e)
+			{
+				PRINT_W("Failed to start shared-memory local server. Error Message: %s", e.what());
+			}
+		}
+	});
 
 	//------- Setup IAS connector:
 	std::shared_ptr<Ias::Connector> iasConnector;
+	std::shared_ptr<ServerApp::CachedIasConnector> cachedIasConnector;
+	std::future<void> iasPrewarm;
 	try 
 	{
-		iasConnector = std::make_shared<Ias::Connector>(serverConfig->GetSgxServiceProviderConfig().GetSubscriptionKey());
+		ServerApp::StartupTimeline::Phase phase(startupTimeline, "IAS connector");
+
+		const std::string& subscriptionKey = serverConfig->GetSgxServiceProviderConfig().GetSubscriptionKey();
+		const auto& spConfig = appConfig->GetServiceProviderConfig();
+		if (spConfig.GetHttpPoolSize() > 0)
+		{
+			std::shared_ptr<ServerApp::PooledIasConnector> pooledIasConnector = std::make_shared<ServerApp::PooledIasConnector>(
+				subscriptionKey, spConfig.GetIasUrl(), spConfig.GetHttpPoolSize(),
+				std::chrono::seconds(spConfig.GetHttpIdleTimeout()), spConfig.IsHttp2());
+			if (spConfig.IsHttpPrewarm())
+			{
+				//Requests to IAS (e.g. the enclave's own attestation) don't wait for the warm-up.
+				const size_t poolSize = spConfig.GetHttpPoolSize();
+				iasPrewarm = std::async(std::launch::async, [&startupTimeline, pooledIasConnector, poolSize]()
+				{
+					ServerApp::StartupTimeline::Phase phase(startupTimeline, "IAS pre-warm");
+					const size_t warmedNum = pooledIasConnector->Prewarm();
+					PRINT_I("Pre-warmed %llu of %llu connections to IAS.", static_cast<unsigned long long>(warmedNum),
+						static_cast<unsigned long long>(poolSize));
+				});
+			}
+			iasConnector = pooledIasConnector;
+		}
+		else
+		{
+			iasConnector = std::make_shared<Ias::Connector>(subscriptionKey);
+		}
+		iasConnector = std::make_shared<ServerApp::MeteredIasConnector>(iasConnector, subscriptionKey, metrics);
+
+		if (admissionConfig.GetMaxIasInFlight() > 0)
+		{
+			iasConnector = std::make_shared<ServerApp::ThrottledIasConnector>(iasConnector, subscriptionKey,
+				admissionConfig.GetMaxIasInFlight(), std::chrono::milliseconds(admissionConfig.GetIasMaxWait()), metrics);
+		}
+
+		const uint64_t sigRlCacheTtl = spConfig.GetSigRlCacheTtl();
+		if (sigRlCacheTtl > 0)
+		{
+			cachedIasConnector = std::make_shared<ServerApp::CachedIasConnector>(iasConnector, subscriptionKey,
+				std::chrono::seconds(sigRlCacheTtl));
+			iasConnector = cachedIasConnector;
+			metrics->SetSigRlCache(cachedIasConnector);
+		}
 	}
 	catch (const std::exception& e)
 	{
@@ -144,10 +280,32 @@ int main(int argc, char ** argv)
 		return -1;
 	}
 	
+	//------- Setup switchless calls:
+	const auto& switchlessConfig = appConfig->GetSwitchlessConfig();
+	size_t switchlessTcsNum = 0;
+	if (switchlessConfig.IsEnabled())
+	{
+		try
+		{
+			ServerApp::EnableSwitchless(switchlessConfig.GetUntrustedWorkers(), switchlessConfig.GetTrustedWorkers());
+			//Each trusted worker stays inside the enclave, on a TCS of its own.
+			switchlessTcsNum = switchlessConfig.GetTrustedWorkers();
+			PRINT_I("Switchless mode is on. Untrusted workers - %llu, trusted workers - %llu.",
+				static_cast<unsigned long long>(switchlessConfig.GetUntrustedWorkers()),
+				static_cast<unsigned long long>(switchlessConfig.GetTrustedWorkers()));
+		}
+		catch (const std::exception& e)
+		{
+			PRINT_W("Failed to turn on switchless mode; normal ECALLs/OCALLs will be used. Error Msg: %s", e.what());
+		}
+	}
+
 	//------- Setup enclave:
 	std::shared_ptr<RaSgx::DecentServer> enclave;
 	try 
 	{
+		ServerApp::StartupTimeline::Phase phase(startupTimeline, "Enclave");
+
 		boost::filesystem::path tokenPath = GetKnownFolderPath(KnownFolderType::LocalAppDataEnclave).append(TOKEN_FILENAME);
 		enclave = std::make_shared<RaSgx::DecentServer>(
 			serverConfig->GetSgxServiceProviderConfig().GetSpid(), iasConnector, ENCLAVE_FILENAME, tokenPath);
@@ -158,16 +316,137 @@ int main(int argc, char ** argv)
 		return -1;
 	}
 
+	const sgx_enclave_id_t enclaveId = enclave->GetEnclaveId();
+	metrics->SetEnclaveHeapStats([enclaveId]()
+	{
+		return ServerApp::GetEnclaveHeapStats(enclaveId);
+	});
+
+	serversSetup.get();
+	if (!tcpServer && !localServer && !shmServer)
+	{
+		PRINT_W("Failed to start all servers. Program will be terminated!");
+		return -1;
+	}
+
+	//------- Setup worker threads and connection pool:
+	const auto& frontEndConfig = appConfig->GetFrontEndConfig();
+
+	//Every worker may be inside the enclave at the same time, so the total is bounded by the TCSs left
+	//after the reserved ones and the switchless trusted workers' ones.
+	const size_t reservedTcsNum = gsk_reservedTcsNum + switchlessTcsNum;
+	if (ENCLAVE_TCS_NUM <= reservedTcsNum)
+	{
+		PRINT_W("Enclave has %llu TCSs, but %llu are reserved for threads other than the workers; only one worker is used.",
+			static_cast<unsigned long long>(ENCLAVE_TCS_NUM), static_cast<unsigned long long>(reservedTcsNum));
+	}
+	const size_t workerTcsNum = ENCLAVE_TCS_NUM > reservedTcsNum ? ENCLAVE_TCS_NUM - reservedTcsNum : 1;
+
+	size_t workerBudget = frontEndConfig.GetWorkerThreads();
+	if (workerBudget == 0)
+	{
+		workerBudget = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	}
+	workerBudget = std::min<size_t>(workerBudget, workerTcsNum);
+
+	size_t tcpWorkerNum = workerBudget;
+	size_t localWorkerNum = workerBudget;
+	if (tcpServer && (localServer || shmServer))
+	{
+		tcpWorkerNum = std::max<size_t>(workerBudget - (workerBudget / 2), 1);
+		localWorkerNum = std::max<size_t>(workerBudget / 2, 1);
+	}
+	//Both local servers share the local half.
+	size_t shmWorkerNum = localWorkerNum;
+	if (localServer && shmServer)
+	{
+		shmWorkerNum = std::max<size_t>(localWorkerNum - (localWorkerNum / 2), 1);
+		localWorkerNum = std::max<size_t>(localWorkerNum / 2, 1);
+	}
+
+	std::shared_ptr<Net::ConnectionPoolBase> cntPool;
+	size_t cntPoolSize = 0;
+	if (frontEndConfig.IsKeepAlive() && frontEndConfig.GetConnectionPoolSize() > 0)
+	{
+		cntPoolSize = frontEndConfig.GetConnectionPoolSize();
+		cntPool = std::make_shared<Net::ConnectionPoolBase>(cntPoolSize);
+	}
+
+	PRINT_I("Worker threads: TCP - %llu, Local - %llu, Shared-memory - %llu; Connection pool size: %llu.",
+		static_cast<unsigned long long>(tcpServer ? tcpWorkerNum : 0), static_cast<unsigned long long>(localServer ? localWorkerNum : 0),
+		static_cast<unsigned long long>(shmServer ? shmWorkerNum : 0), static_cast<unsigned long long>(cntPoolSize));
+
 	//------- Add servers to smart server.
-	smartServer.AddServer(tcpServer, enclave, nullptr, 1, 0);
-	smartServer.AddServer(localServer, enclave, nullptr, 1, 0);
+	//Metrics are only served through the local servers.
+	if (tcpServer)
+	{
+		std::shared_ptr<Net::ConnectionHandler> tcpHandler = std::make_shared<ServerApp::FrontEndHandler>(enclave, metrics, false);
+		smartServer.AddServer(tcpServer, tcpHandler, cntPool, tcpWorkerNum, cntPoolSize);
+		metrics->m_totalWorkers += tcpWorkerNum;
+		if (admission)
+		{
+			admission->SetWorkers(tcpWorkerNum);
+		}
+	}
+	if (localServer)
+	{
+		std::shared_ptr<Net::ConnectionHandler> localHandler = std::make_shared<ServerApp::FrontEndHandler>(enclave, metrics, true);
+		smartServer.AddServer(localServer, localHandler, cntPool, localWorkerNum, cntPoolSize);
+		metrics->m_totalWorkers += localWorkerNum;
+	}
+	if (shmServer)
+	{
+		std::shared_ptr<Net::ConnectionHandler> shmHandler = std::make_shared<ServerApp::FrontEndHandler>(enclave, metrics, true);
+		smartServer.AddServer(shmServer, shmHandler, cntPool, shmWorkerNum, cntPoolSize);
+		metrics->m_totalWorkers += shmWorkerNum;
+	}
+
+	if (iasPrewarm.valid())
+	{
+		iasPrewarm.wait();
+	}
+	startupTimeline.Print();
+
+	//------- Setup metrics dump:
+	std::unique_ptr<ServerApp::MetricsDumper> metricsDumper;
+	const auto& metricsConfig = appConfig->GetMetricsConfig();
+	if (metricsConfig.GetPrometheusFile().size() > 0)
+	{
+		metricsDumper = std::make_unique<ServerApp::MetricsDumper>(metrics, metricsConfig.GetPrometheusFile(),
+			std::chrono::seconds(std::max<uint64_t>(metricsConfig.GetDumpInterval(), 1)));
+	}
 
 	//------- keep running until an interrupt signal (Ctrl + C) is received.
 	mainThreadWorker->UpdateUntilInterrupt();
 
 	//------- Exit...
-	enclave.reset();
 	smartServer.Terminate();
+	if (Perf::Tracer::GetInstance().IsEnabled())
+	{
+		Perf::Tracer::GetInstance().Stop();
+		PRINT_I("Tracing stopped; %llu spans were dropped.", static_cast<unsigned long long>(Perf::Tracer::GetInstance().GetDroppedCount()));
+	}
+	try
+	{
+		const ServerApp::EnclaveHeapStats heapStats = ServerApp::GetEnclaveHeapStats(enclaveId);
+		PRINT_I("Enclave heap: peak %llu bytes in use, peak %llu bytes reserved, %llu failed allocations; peak stack: at least %llu bytes.",
+			static_cast<unsigned long long>(heapStats.m_peakInUse), static_cast<unsigned long long>(heapStats.m_peakReserved),
+			static_cast<unsigned long long>(heapStats.m_failedCnt), static_cast<unsigned long long>(heapStats.m_peakStack));
+	}
+	catch (const std::exception& e)
+	{
+		PRINT_W("Failed to get heap stats of the enclave. Error Msg: %s", e.what());
+	}
+	metricsDumper.reset();
+	enclave.reset();
+
+	if (cachedIasConnector)
+	{
+		PRINT_I("SigRL cache: %llu hits, %llu misses, %llu coalesced.",
+			static_cast<unsigned long long>(cachedIasConnector->GetHitCount()),
+			static_cast<unsigned long long>(cachedIasConnector->GetMissCount()),
+			static_cast<unsigned long long>(cachedIasConnector->GetCoalescedCount()));
+	}
 
 	PRINT_I("Exit ...\n");
 	return 0;
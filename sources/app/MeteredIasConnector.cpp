@@ -0,0 +1,72 @@
+#include "MeteredIasConnector.h"
+
+#include <chrono>
+
+#include "../CommonApp/Tracer.h"
+
+#include "ServerMetrics.h"
+
+using namespace Decent;
+using namespace Decent::ServerApp;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	static uint64_t ElapsedUs(Clock::time_point start)
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+	}
+}
+
+MeteredIasConnector::MeteredIasConnector(std::shared_ptr<Ias::Connector> upstream, const std::string & subscriptionKey, std::shared_ptr<ServerMetrics> metrics) :
+	Ias::Connector(subscriptionKey),
+	m_upstream(upstream),
+	m_metrics(metrics)
+{
+}
+
+MeteredIasConnector::~MeteredIasConnector()
+{
+}
+
+std::string MeteredIasConnector::GetSigRl(const sgx_epid_group_id_t & gid) const
+{
+	Perf::TraceSpan span("Ias.GetSigRl");
+	const Clock::time_point start = Clock::now();
+	try
+	{
+		std::string sigRl = m_upstream->GetSigRl(gid);
+
+		const uint64_t elapsed = ElapsedUs(start);
+		m_metrics->m_iasSigRl.Record(elapsed);
+		ServerMetrics::AddThreadIasTime(elapsed);
+		return sigRl;
+	}
+	catch (...)
+	{
+		ServerMetrics::AddThreadIasTime(ElapsedUs(start));
+		m_metrics->m_iasSigRlErrCnt.fetch_add(1, std::memory_order_relaxed);
+		throw;
+	}
+}
+
+void MeteredIasConnector::GetQuoteReport(const std::string & jsonReqBody, std::string & outReport, std::string & outSign, std::string & outCert) const
+{
+	Perf::TraceSpan span("Ias.GetReport");
+	const Clock::time_point start = Clock::now();
+	try
+	{
+		m_upstream->GetQuoteReport(jsonReqBody, outReport, outSign, outCert);
+
+		const uint64_t elapsed = ElapsedUs(start);
+		m_metrics->m_iasReport.Record(elapsed);
+		ServerMetrics::AddThreadIasTime(elapsed);
+	}
+	catch (...)
+	{
+		ServerMetrics::AddThreadIasTime(ElapsedUs(start));
+		m_metrics->m_iasReportErrCnt.fetch_add(1, std::memory_order_relaxed);
+		throw;
+	}
+}
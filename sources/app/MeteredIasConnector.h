@@ -0,0 +1,41 @@
+#pragma once
+
+#include <memory>
+
+#include <DecentApi/CommonApp/SGX/IasConnector.h>
+
+namespace Decent
+{
+	namespace ServerApp
+	{
+		class ServerMetrics;
+
+		/**
+		 * \brief	An IAS connector that times the requests of the upstream connector, and counts the
+		 * 			failed ones.
+		 */
+		class MeteredIasConnector : public Ias::Connector
+		{
+		public:
+			/**
+			 * \brief	Constructor
+			 *
+			 * \param	upstream	   	The connector that actually talks to IAS.
+			 * \param	subscriptionKey	The IAS subscription key (only used by the base class).
+			 * \param	metrics		   	The metrics to update.
+			 */
+			MeteredIasConnector(std::shared_ptr<Ias::Connector> upstream, const std::string& subscriptionKey,
+				std::shared_ptr<ServerMetrics> metrics);
+
+			virtual ~MeteredIasConnector();
+
+			virtual std::string GetSigRl(const sgx_epid_group_id_t& gid) const override;
+
+			virtual void GetQuoteReport(const std::string& jsonReqBody, std::string& outReport, std::string& outSign, std::string& outCert) const override;
+
+		private:
+			std::shared_ptr<Ias::Connector> m_upstream;
+			std::shared_ptr<ServerMetrics> m_metrics;
+		};
+	}
+}
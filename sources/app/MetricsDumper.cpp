@@ -0,0 +1,71 @@
+#include "MetricsDumper.h"
+
+#include <fstream>
+#include <stdexcept>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <DecentApi/Common/Common.h>
+
+#include "ServerMetrics.h"
+
+using namespace Decent;
+using namespace Decent::ServerApp;
+
+MetricsDumper::MetricsDumper(std::shared_ptr<const ServerMetrics> metrics, const std::string & path, std::chrono::seconds interval) :
+	m_metrics(metrics),
+	m_path(path),
+	m_interval(interval),
+	m_stopMutex(),
+	m_stopSignal(),
+	m_isStopped(false),
+	m_thread()
+{
+	m_thread = std::thread(&MetricsDumper::Worker, this);
+}
+
+MetricsDumper::~MetricsDumper()
+{
+	{
+		std::unique_lock<std::mutex> stopLock(m_stopMutex);
+		m_isStopped = true;
+	}
+	m_stopSignal.notify_all();
+	m_thread.join();
+}
+
+void MetricsDumper::Dump() const
+{
+	const std::string tmpPath = m_path + ".tmp";
+	{
+		std::ofstream file(tmpPath, std::ios_base::out | std::ios_base::trunc);
+		file << m_metrics->ToPrometheus();
+		file.close();
+		if (!file)
+		{
+			throw std::runtime_error("Failed to write to " + tmpPath + ".");
+		}
+	}
+	boost::filesystem::rename(tmpPath, m_path);
+}
+
+void MetricsDumper::Worker()
+{
+	bool isStopped = false;
+	while (!isStopped)
+	{
+		{
+			std::unique_lock<std::mutex> stopLock(m_stopMutex);
+			isStopped = m_stopSignal.wait_for(stopLock, m_interval, [this]() { return m_isStopped; });
+		}
+
+		try
+		{
+			Dump();
+		}
+		catch (const std::exception& e)
+		{
+			PRINT_W("Failed to dump metrics. Error Msg: %s", e.what());
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <condition_variable>
+
+namespace Decent
+{
+	namespace ServerApp
+	{
+		class ServerMetrics;
+
+		/**
+		 * \brief	Periodically writes the metrics, in Prometheus text format, to a file. The file is
+		 * 			replaced as a whole each time, so a reader never sees a partially written file.
+		 */
+		class MetricsDumper
+		{
+		public:
+			/**
+			 * \brief	Constructor. The dumping thread is started here.
+			 *
+			 * \param	metrics 	The metrics.
+			 * \param	path		The path of the output file.
+			 * \param	interval	The dump interval.
+			 */
+			MetricsDumper(std::shared_ptr<const ServerMetrics> metrics, const std::string& path, std::chrono::seconds interval);
+
+			/** \brief	Destructor. The dumping thread is stopped, after one last dump. */
+			virtual ~MetricsDumper();
+
+			/**
+			 * \brief	Writes the metrics to the file now.
+			 *
+			 * \exception	std::exception	Thrown if the file can't be written.
+			 */
+			void Dump() const;
+
+		private:
+			void Worker();
+
+			std::shared_ptr<const ServerMetrics> m_metrics;
+			const std::string m_path;
+			const std::chrono::seconds m_interval;
+
+			std::mutex m_stopMutex;
+			std::condition_variable m_stopSignal;
+			bool m_isStopped;
+
+			std::thread m_thread;
+		};
+	}
+}
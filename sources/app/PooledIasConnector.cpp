@@ -0,0 +1,359 @@
+#include "PooledIasConnector.h"
+
+#include <cctype>
+#include <cstdio>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+
+using namespace Decent;
+using namespace Decent::ServerApp;
+
+namespace
+{
+	static constexpr char gsk_subscriptionKeyHeader[] = "Ocp-Apim-Subscription-Key: ";
+	static constexpr char gsk_reportSignHeader[] = "X-IASReport-Signature";
+	static constexpr char gsk_reportCertHeader[] = "X-IASReport-Signing-Certificate";
+
+	static constexpr long gsk_connectTimeout = 10;
+	static constexpr long gsk_transferTimeout = 30;
+
+	static size_t WriteBody(char* ptr, size_t size, size_t nmemb, void* userData)
+	{
+		static_cast<std::string*>(userData)->append(ptr, size * nmemb);
+		return size * nmemb;
+	}
+
+	static size_t WriteHeader(char* ptr, size_t size, size_t nitems, void* userData)
+	{
+		auto& headers = *static_cast<std::vector<std::pair<std::string, std::string> >*>(userData);
+		const std::string line(ptr, size * nitems);
+
+		const size_t colonPos = line.find(':');
+		if (colonPos != std::string::npos)
+		{
+			size_t valBegin = colonPos + 1;
+			size_t valEnd = line.size();
+			while (valBegin < valEnd && std::isspace(static_cast<unsigned char>(line[valBegin])))
+			{
+				++valBegin;
+			}
+			while (valEnd > valBegin && std::isspace(static_cast<unsigned char>(line[valEnd - 1])))
+			{
+				--valEnd;
+			}
+			headers.emplace_back(line.substr(0, colonPos), line.substr(valBegin, valEnd - valBegin));
+		}
+		return size * nitems;
+	}
+
+	static bool IsNameEqual(const std::string& a, const std::string& b)
+	{
+		if (a.size() != b.size())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i])))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/** \brief	The GID in the SigRL path is the hex of the (little-endian) 32-bit group ID. */
+	static std::string GidToHex(const sgx_epid_group_id_t& gid)
+	{
+		char buf[9];
+		std::snprintf(buf, sizeof(buf), "%02x%02x%02x%02x", gid[3], gid[2], gid[1], gid[0]);
+		return buf;
+	}
+
+	static int HexToInt(char ch)
+	{
+		if (ch >= '0' && ch <= '9')
+		{
+			return ch - '0';
+		}
+		ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+		if (ch >= 'a' && ch <= 'f')
+		{
+			return ch - 'a' + 10;
+		}
+		throw std::runtime_error("Invalid URL encoding in the IAS report signing certificate.");
+	}
+
+	static std::string UrlDecode(const std::string& str)
+	{
+		std::string res;
+		res.reserve(str.size());
+		for (size_t i = 0; i < str.size(); ++i)
+		{
+			if (str[i] == '%' && i + 2 < str.size())
+			{
+				res.push_back(static_cast<char>((HexToInt(str[i + 1]) << 4) | HexToInt(str[i + 2])));
+				i += 2;
+			}
+			else if (str[i] == '%')
+			{
+				throw std::runtime_error("Invalid URL encoding in the IAS report signing certificate.");
+			}
+			else
+			{
+				res.push_back(str[i]);
+			}
+		}
+		return res;
+	}
+}
+
+std::string PooledIasConnector::Response::GetHeader(const std::string & name) const
+{
+	for (const auto& header : m_headers)
+	{
+		if (IsNameEqual(header.first, name))
+		{
+			return header.second;
+		}
+	}
+	return std::string();
+}
+
+PooledIasConnector::HandleLease::HandleLease(const PooledIasConnector & pool) :
+	m_pool(pool),
+	m_handle(nullptr)
+{
+	std::unique_lock<std::mutex> poolLock(m_pool.m_poolMutex);
+	m_pool.m_poolSignal.wait(poolLock, [this]() { return m_pool.m_idleHandles.size() > 0; });
+
+	m_handle = m_pool.m_idleHandles.back();
+	m_pool.m_idleHandles.pop_back();
+}
+
+PooledIasConnector::HandleLease::~HandleLease()
+{
+	{
+		std::unique_lock<std::mutex> poolLock(m_pool.m_poolMutex);
+		m_pool.m_idleHandles.push_back(m_handle);
+	}
+	m_pool.m_poolSignal.notify_one();
+}
+
+PooledIasConnector::PooledIasConnector(const std::string & subscriptionKey, const std::string & iasUrl, size_t poolSize,
+	std::chrono::seconds idleTimeout, bool isHttp2) :
+	Ias::Connector(subscriptionKey),
+	m_subscriptionKey(subscriptionKey),
+	m_iasUrl(iasUrl),
+	m_idleTimeout(idleTimeout),
+	m_isHttp2(isHttp2),
+	m_share(nullptr),
+	m_shareMutexes(),
+	m_handles(),
+	m_poolMutex(),
+	m_poolSignal(),
+	m_idleHandles()
+{
+	if (poolSize == 0)
+	{
+		throw std::runtime_error("The size of IAS connection pool must be larger than zero.");
+	}
+
+	curl_global_init(CURL_GLOBAL_DEFAULT);
+
+	m_share = curl_share_init();
+	if (m_share == nullptr)
+	{
+		curl_global_cleanup();
+		throw std::runtime_error("Failed to create curl share handle.");
+	}
+	for (int i = 0; i < CURL_LOCK_DATA_LAST; ++i)
+	{
+		m_shareMutexes.emplace_back(new std::mutex());
+	}
+	curl_share_setopt(m_share, CURLSHOPT_LOCKFUNC, &PooledIasConnector::ShareLock);
+	curl_share_setopt(m_share, CURLSHOPT_UNLOCKFUNC, &PooledIasConnector::ShareUnlock);
+	curl_share_setopt(m_share, CURLSHOPT_USERDATA, this);
+	curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+	curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+	curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+
+	for (size_t i = 0; i < poolSize; ++i)
+	{
+		CURL* handle = curl_easy_init();
+		if (handle == nullptr)
+		{
+			break;
+		}
+		m_handles.push_back(handle);
+		SetHandleOptions(handle);
+
+		m_idleHandles.push_back(handle);
+	}
+
+	if (m_handles.size() != poolSize)
+	{
+		for (CURL* handle : m_handles)
+		{
+			curl_easy_cleanup(handle);
+		}
+		curl_share_cleanup(m_share);
+		curl_global_cleanup();
+		throw std::runtime_error("Failed to create curl handles.");
+	}
+}
+
+PooledIasConnector::~PooledIasConnector()
+{
+	for (CURL* handle : m_handles)
+	{
+		curl_easy_cleanup(handle);
+	}
+	curl_share_cleanup(m_share);
+	curl_global_cleanup();
+}
+
+std::string PooledIasConnector::GetSigRl(const sgx_epid_group_id_t & gid) const
+{
+	Response resp = Perform("/sigrl/" + GidToHex(gid), nullptr);
+	if (resp.m_status != 200)
+	{
+		throw std::runtime_error("IAS returned HTTP " + std::to_string(resp.m_status) + " for the SigRL request.");
+	}
+	return resp.m_body;
+}
+
+void PooledIasConnector::GetQuoteReport(const std::string & jsonReqBody, std::string & outReport, std::string & outSign, std::string & outCert) const
+{
+	Response resp = Perform("/report", &jsonReqBody);
+	if (resp.m_status != 200)
+	{
+		throw std::runtime_error("IAS returned HTTP " + std::to_string(resp.m_status) + " for the report request.");
+	}
+
+	outSign = resp.GetHeader(gsk_reportSignHeader);
+	const std::string encodedCert = resp.GetHeader(gsk_reportCertHeader);
+	if (outSign.empty() || encodedCert.empty())
+	{
+		throw std::runtime_error("The IAS report response doesn't have a signature or certificate.");
+	}
+
+	outCert = UrlDecode(encodedCert);
+	outReport.swap(resp.m_body);
+}
+
+size_t PooledIasConnector::Prewarm()
+{
+	std::atomic<size_t> warmedNum(0);
+
+	//Warmed with handles of its own, so requests can lease pooled handles meanwhile (e.g. when IAS is
+	//	slow to answer). They share the connection cache, so the pooled handles reuse what they open.
+	std::vector<std::thread> threads;
+	threads.reserve(m_handles.size());
+	for (size_t i = 0; i < m_handles.size(); ++i)
+	{
+		threads.emplace_back([this, &warmedNum]()
+		{
+			CURL* handle = curl_easy_init();
+			if (handle == nullptr)
+			{
+				return;
+			}
+			SetHandleOptions(handle);
+
+			//Any response (even an error status) means the connection is up and now cached.
+			Response resp;
+			curl_easy_setopt(handle, CURLOPT_URL, m_iasUrl.c_str());
+			curl_easy_setopt(handle, CURLOPT_NOBODY, 1L);
+			curl_easy_setopt(handle, CURLOPT_WRITEDATA, &resp.m_body);
+			curl_easy_setopt(handle, CURLOPT_HEADERDATA, &resp.m_headers);
+			if (curl_easy_perform(handle) == CURLE_OK)
+			{
+				++warmedNum;
+			}
+			curl_easy_cleanup(handle);
+		});
+	}
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	return warmedNum;
+}
+
+void PooledIasConnector::SetHandleOptions(CURL * handle) const
+{
+	curl_easy_setopt(handle, CURLOPT_SHARE, m_share);
+	curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(handle, CURLOPT_TCP_NODELAY, 1L);
+	curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+#if LIBCURL_VERSION_NUM >= 0x074100
+	//Added in libcurl 7.65.0; older ones keep idle connections until the server closes them.
+	curl_easy_setopt(handle, CURLOPT_MAXAGE_CONN, static_cast<long>(m_idleTimeout.count()));
+#endif
+	curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT, gsk_connectTimeout);
+	curl_easy_setopt(handle, CURLOPT_TIMEOUT, gsk_transferTimeout);
+	curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, m_isHttp2 ? CURL_HTTP_VERSION_2TLS : CURL_HTTP_VERSION_1_1);
+	curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, &WriteBody);
+	curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, &WriteHeader);
+}
+
+PooledIasConnector::Response PooledIasConnector::Perform(const std::string & path, const std::string * body) const
+{
+	Response resp;
+	const std::string url = m_iasUrl + path;
+
+	curl_slist* headers = curl_slist_append(nullptr, (gsk_subscriptionKeyHeader + m_subscriptionKey).c_str());
+	if (body != nullptr)
+	{
+		headers = curl_slist_append(headers, "Content-Type: application/json");
+	}
+
+	CURLcode res = CURLE_OK;
+	{
+		HandleLease lease(*this);
+		CURL* handle = lease.Get();
+
+		curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+		curl_easy_setopt(handle, CURLOPT_HTTPHEADER, headers);
+		curl_easy_setopt(handle, CURLOPT_WRITEDATA, &resp.m_body);
+		curl_easy_setopt(handle, CURLOPT_HEADERDATA, &resp.m_headers);
+		if (body != nullptr)
+		{
+			curl_easy_setopt(handle, CURLOPT_POSTFIELDS, body->data());
+			curl_easy_setopt(handle, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(body->size()));
+		}
+		else
+		{
+			curl_easy_setopt(handle, CURLOPT_HTTPGET, 1L);
+		}
+
+		res = curl_easy_perform(handle);
+		if (res == CURLE_OK)
+		{
+			curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &resp.m_status);
+		}
+
+		curl_easy_setopt(handle, CURLOPT_HTTPHEADER, nullptr);
+	}
+	curl_slist_free_all(headers);
+
+	if (res != CURLE_OK)
+	{
+		throw std::runtime_error(std::string("Failed to send request to IAS. ") + curl_easy_strerror(res));
+	}
+	return resp;
+}
+
+void PooledIasConnector::ShareLock(CURL * handle, curl_lock_data data, curl_lock_access access, void * userPtr)
+{
+	static_cast<PooledIasConnector*>(userPtr)->m_shareMutexes[data]->lock();
+}
+
+void PooledIasConnector::ShareUnlock(CURL * handle, curl_lock_data data, void * userPtr)
+{
+	static_cast<PooledIasConnector*>(userPtr)->m_shareMutexes[data]->unlock();
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <condition_variable>
+
+#include <curl/curl.h>
+
+#include <DecentApi/CommonApp/SGX/IasConnector.h>
+
+namespace Decent
+{
+	namespace ServerApp
+	{
+		/**
+		 * \brief	An IAS connector talking to the IAS REST API over a bounded pool of reusable curl
+		 * 			handles. Handles share the DNS cache, TLS sessions and the connection cache, and
+		 * 			connections are kept alive between requests, so most requests skip the TCP and TLS
+		 * 			setup. At most pool size requests are sent at the same time; the rest wait for a
+		 * 			free handle.
+		 */
+		class PooledIasConnector : public Ias::Connector
+		{
+		public:
+			/**
+			 * \brief	Constructor
+			 *
+			 * \exception	std::runtime_error	Thrown if curl fails to initialize.
+			 *
+			 * \param	subscriptionKey	The IAS subscription key.
+			 * \param	iasUrl		   	The base URL of the attestation API (i.e. the parent of "sigrl"
+			 * 							and "report"). It may point to a plain HTTP stand-in for testing,
+			 * 							such as IasHttpStandIn.py.
+			 * \param	poolSize	   	Number of curl handles; must be larger than zero.
+			 * \param	idleTimeout	   	How long an idle connection is kept for reuse. It needs libcurl
+			 * 							7.65.0 or newer, and is ignored by older ones.
+			 * \param	isHttp2		   	True to use HTTP/2 when the server supports it. Each handle still
+			 * 							sends one request at a time on its own connection, so requests are
+			 * 							not multiplexed.
+			 */
+			PooledIasConnector(const std::string& subscriptionKey, const std::string& iasUrl, size_t poolSize,
+				std::chrono::seconds idleTimeout, bool isHttp2);
+
+			virtual ~PooledIasConnector();
+
+			virtual std::string GetSigRl(const sgx_epid_group_id_t& gid) const override;
+
+			virtual void GetQuoteReport(const std::string& jsonReqBody, std::string& outReport, std::string& outSign, std::string& outCert) const override;
+
+			/**
+			 * \brief	Opens as many connections as there are handles in the pool, in parallel, so the
+			 * 			first requests don't have to. It doesn't take handles from the pool, so requests
+			 * 			aren't held up by it.
+			 *
+			 * \return	Number of handles that connected successfully.
+			 */
+			size_t Prewarm();
+
+		private:
+			struct Response
+			{
+				long m_status = 0;
+				std::string m_body;
+				std::vector<std::pair<std::string, std::string> > m_headers;
+
+				/**
+				 * \brief	Finds a header by its (case-insensitive) name.
+				 *
+				 * \return	The value, or empty if it's not found.
+				 */
+				std::string GetHeader(const std::string& name) const;
+			};
+
+			/** \brief	Takes a handle from the pool, and gives it back when it goes out of scope. */
+			class HandleLease
+			{
+			public:
+				HandleLease(const PooledIasConnector& pool);
+
+				~HandleLease();
+
+				CURL* Get() const noexcept { return m_handle; }
+
+			private:
+				const PooledIasConnector& m_pool;
+				CURL* m_handle;
+			};
+
+			/**
+			 * \brief	Sends a request with a pooled handle.
+			 *
+			 * \exception	std::runtime_error	Thrown if the transfer fails (but not on HTTP errors).
+			 *
+			 * \param	path	The path relative to the base URL.
+			 * \param	body	The body of a POST request; nullptr for a GET request.
+			 *
+			 * \return	The response.
+			 */
+			Response Perform(const std::string& path, const std::string* body) const;
+
+			/** \brief	Sets the options every handle of this connector shares, including the share handle. */
+			void SetHandleOptions(CURL* handle) const;
+
+			static void ShareLock(CURL* handle, curl_lock_data data, curl_lock_access access, void* userPtr);
+
+			static void ShareUnlock(CURL* handle, curl_lock_data data, void* userPtr);
+
+			const std::string m_subscriptionKey;
+			const std::string m_iasUrl;
+			const std::chrono::seconds m_idleTimeout;
+			const bool m_isHttp2;
+
+			CURLSH* m_share;
+			std::vector<std::unique_ptr<std::mutex> > m_shareMutexes;
+
+			std::vector<CURL*> m_handles;
+
+			mutable std::mutex m_poolMutex;
+			mutable std::condition_variable m_poolSignal;
+			mutable std::vector<CURL*> m_idleHandles;
+		};
+	}
+}
@@ -0,0 +1,194 @@
+#include "ServerMetrics.h"
+
+#include <sstream>
+
+#include <json/json.h>
+
+#include "CachedIasConnector.h"
+#include "HeapStatsEnclave.h"
+
+using namespace Decent;
+using namespace Decent::ServerApp;
+
+namespace
+{
+	struct StageRef
+	{
+		const char* m_name;
+		const Perf::LatencyHistogram& m_hist;
+	};
+
+	static constexpr double gsk_quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+	static constexpr char const* gsk_quantileNames[] = { "P50", "P90", "P99", "P999" };
+
+	static thread_local uint64_t gs_threadIasTime = 0;
+
+	static Json::Value HistogramToJson(const Perf::LatencyHistogram& hist)
+	{
+		Json::Value res;
+		res["Count"] = static_cast<Json::UInt64>(hist.GetCount());
+		res["Mean"] = hist.GetMean();
+		res["Max"] = static_cast<Json::UInt64>(hist.GetMax());
+		for (size_t i = 0; i < sizeof(gsk_quantiles) / sizeof(gsk_quantiles[0]); ++i)
+		{
+			res[gsk_quantileNames[i]] = static_cast<Json::UInt64>(hist.GetPercentile(gsk_quantiles[i] * 100.0));
+		}
+		return res;
+	}
+}
+
+ServerMetrics::ServerMetrics() :
+	m_acceptedCnt(0),
+	m_activeCnt(0),
+	m_handledCnt(0),
+	m_failedCnt(0),
+	m_iasSigRlErrCnt(0),
+	m_iasReportErrCnt(0),
+	m_busyWorkers(0),
+	m_totalWorkers(0),
+	m_admissionRejectedCnt(0),
+	m_deadlineShedCnt(0),
+	m_iasThrottledCnt(0),
+	m_sigRlCache(),
+	m_heapStatsGetter()
+{
+}
+
+ServerMetrics::~ServerMetrics()
+{
+}
+
+void ServerMetrics::SetSigRlCache(std::shared_ptr<const CachedIasConnector> sigRlCache)
+{
+	m_sigRlCache = sigRlCache;
+}
+
+void ServerMetrics::SetEnclaveHeapStats(std::function<EnclaveHeapStats()> getter)
+{
+	m_heapStatsGetter = getter;
+}
+
+std::string ServerMetrics::ToJson() const
+{
+	Json::Value root;
+
+	Json::Value& stages = root["LatencyUs"];
+	stages["QueueWait"] = HistogramToJson(m_queueWait);
+	stages["Handler"] = HistogramToJson(m_handler);
+	stages["HandlerExclIas"] = HistogramToJson(m_handlerExclIas);
+	stages["IasSigRl"] = HistogramToJson(m_iasSigRl);
+	stages["IasReport"] = HistogramToJson(m_iasReport);
+
+	Json::Value& counters = root["Counters"];
+	counters["Accepted"] = static_cast<Json::UInt64>(m_acceptedCnt.load());
+	counters["Active"] = static_cast<Json::UInt64>(m_activeCnt.load());
+	counters["Handled"] = static_cast<Json::UInt64>(m_handledCnt.load());
+	counters["Failed"] = static_cast<Json::UInt64>(m_failedCnt.load());
+	counters["IasSigRlErrors"] = static_cast<Json::UInt64>(m_iasSigRlErrCnt.load());
+	counters["IasReportErrors"] = static_cast<Json::UInt64>(m_iasReportErrCnt.load());
+	counters["BusyWorkers"] = static_cast<Json::UInt64>(m_busyWorkers.load());
+	counters["TotalWorkers"] = static_cast<Json::UInt64>(m_totalWorkers.load());
+	counters["AdmissionRejected"] = static_cast<Json::UInt64>(m_admissionRejectedCnt.load());
+	counters["DeadlineShed"] = static_cast<Json::UInt64>(m_deadlineShedCnt.load());
+	counters["IasThrottled"] = static_cast<Json::UInt64>(m_iasThrottledCnt.load());
+
+	if (m_sigRlCache)
+	{
+		counters["SigRlCacheHits"] = static_cast<Json::UInt64>(m_sigRlCache->GetHitCount());
+		counters["SigRlCacheMisses"] = static_cast<Json::UInt64>(m_sigRlCache->GetMissCount());
+		counters["SigRlCacheCoalesced"] = static_cast<Json::UInt64>(m_sigRlCache->GetCoalescedCount());
+	}
+
+	if (m_heapStatsGetter)
+	{
+		const EnclaveHeapStats heapStats = m_heapStatsGetter();
+		Json::Value& heap = root["EnclaveHeap"];
+		heap["InUse"] = static_cast<Json::UInt64>(heapStats.m_inUse);
+		heap["PeakInUse"] = static_cast<Json::UInt64>(heapStats.m_peakInUse);
+		heap["Reserved"] = static_cast<Json::UInt64>(heapStats.m_reserved);
+		heap["PeakReserved"] = static_cast<Json::UInt64>(heapStats.m_peakReserved);
+		heap["Failed"] = static_cast<Json::UInt64>(heapStats.m_failedCnt);
+		heap["PeakStack"] = static_cast<Json::UInt64>(heapStats.m_peakStack);
+	}
+
+	Json::StreamWriterBuilder writerBuilder;
+	writerBuilder["indentation"] = "";
+	return Json::writeString(writerBuilder, root);
+}
+
+std::string ServerMetrics::ToPrometheus() const
+{
+	const StageRef stages[] = {
+		{ "queue_wait", m_queueWait },
+		{ "handler", m_handler },
+		{ "handler_excl_ias", m_handlerExclIas },
+		{ "ias_sigrl", m_iasSigRl },
+		{ "ias_report", m_iasReport },
+	};
+
+	std::stringstream ss;
+
+	ss << "# HELP decent_server_stage_latency_microseconds Latency of each stage of handling a connection.\n";
+	ss << "# TYPE decent_server_stage_latency_microseconds summary\n";
+	for (const StageRef& stage : stages)
+	{
+		for (size_t i = 0; i < sizeof(gsk_quantiles) / sizeof(gsk_quantiles[0]); ++i)
+		{
+			ss << "decent_server_stage_latency_microseconds{stage=\"" << stage.m_name << "\",quantile=\"" << gsk_quantiles[i] << "\"} "
+				<< stage.m_hist.GetPercentile(gsk_quantiles[i] * 100.0) << '\n';
+		}
+		ss << "decent_server_stage_latency_microseconds_sum{stage=\"" << stage.m_name << "\"} " << stage.m_hist.GetSum() << '\n';
+		ss << "decent_server_stage_latency_microseconds_count{stage=\"" << stage.m_name << "\"} " << stage.m_hist.GetCount() << '\n';
+	}
+
+	const auto writeMetric = [&ss](const char* name, const char* type, const char* help, uint64_t value)
+	{
+		ss << "# HELP " << name << ' ' << help << '\n';
+		ss << "# TYPE " << name << ' ' << type << '\n';
+		ss << name << ' ' << value << '\n';
+	};
+
+	writeMetric("decent_server_connections_accepted_total", "counter", "Connections accepted.", m_acceptedCnt);
+	writeMetric("decent_server_connections_active", "gauge", "Connections accepted but not closed yet.", m_activeCnt);
+	writeMetric("decent_server_messages_handled_total", "counter", "Messages handled successfully.", m_handledCnt);
+	writeMetric("decent_server_messages_failed_total", "counter", "Messages whose handler failed.", m_failedCnt);
+	writeMetric("decent_server_ias_sigrl_errors_total", "counter", "Failed upstream SigRL requests.", m_iasSigRlErrCnt);
+	writeMetric("decent_server_ias_report_errors_total", "counter", "Failed upstream report requests.", m_iasReportErrCnt);
+	writeMetric("decent_server_workers_busy", "gauge", "Workers handling a message.", m_busyWorkers);
+	writeMetric("decent_server_workers_total", "gauge", "Workers of all servers.", m_totalWorkers);
+	writeMetric("decent_server_admission_rejected_total", "counter", "Connections turned away by admission control.", m_admissionRejectedCnt);
+	writeMetric("decent_server_deadline_shed_total", "counter", "Connections dropped since they would miss their deadline.", m_deadlineShedCnt);
+	writeMetric("decent_server_ias_throttled_total", "counter", "IAS requests failed waiting for their turn.", m_iasThrottledCnt);
+
+	if (m_sigRlCache)
+	{
+		writeMetric("decent_server_sigrl_cache_hits_total", "counter", "SigRL cache hits.", m_sigRlCache->GetHitCount());
+		writeMetric("decent_server_sigrl_cache_misses_total", "counter", "SigRL cache misses.", m_sigRlCache->GetMissCount());
+		writeMetric("decent_server_sigrl_cache_coalesced_total", "counter", "SigRL requests that joined an in-flight fetch.", m_sigRlCache->GetCoalescedCount());
+	}
+
+	if (m_heapStatsGetter)
+	{
+		const EnclaveHeapStats heapStats = m_heapStatsGetter();
+		writeMetric("decent_server_enclave_heap_in_use_bytes", "gauge", "Bytes of live objects in the enclave.", heapStats.m_inUse);
+		writeMetric("decent_server_enclave_heap_peak_in_use_bytes", "gauge", "High-water mark of live objects in the enclave.", heapStats.m_peakInUse);
+		writeMetric("decent_server_enclave_heap_reserved_bytes", "gauge", "Bytes taken from the enclave heap.", heapStats.m_reserved);
+		writeMetric("decent_server_enclave_heap_peak_reserved_bytes", "gauge", "High-water mark of bytes taken from the enclave heap.", heapStats.m_peakReserved);
+		writeMetric("decent_server_enclave_heap_failures_total", "counter", "Allocations failed in the enclave.", heapStats.m_failedCnt);
+		writeMetric("decent_server_enclave_stack_peak_bytes", "gauge", "Lower bound of the deepest enclave stack, from the stack pointers seen at allocations.", heapStats.m_peakStack);
+	}
+
+	return ss.str();
+}
+
+void ServerMetrics::AddThreadIasTime(uint64_t us) noexcept
+{
+	gs_threadIasTime += us;
+}
+
+uint64_t ServerMetrics::TakeThreadIasTime() noexcept
+{
+	const uint64_t res = gs_threadIasTime;
+	gs_threadIasTime = 0;
+	return res;
+}
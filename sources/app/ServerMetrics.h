@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <functional>
+
+#include "../CommonApp/LatencyHistogram.h"
+
+namespace Decent
+{
+	namespace ServerApp
+	{
+		class CachedIasConnector;
+		struct EnclaveHeapStats;
+
+		/**
+		 * \brief	Counters and latency histograms of the Decent Server front end. Everything is
+		 * 			updated with relaxed atomic operations, so it's cheap enough to stay on all the time.
+		 */
+		class ServerMetrics
+		{
+		public:
+			ServerMetrics();
+
+			virtual ~ServerMetrics();
+
+			/** \brief	Time from accepting a connection, to a worker starting to handle it. */
+			Perf::LatencyHistogram m_queueWait;
+
+			/** \brief	Time spent in the enclave's message handler (i.e. the whole handshake). */
+			Perf::LatencyHistogram m_handler;
+
+			/** \brief	Handler time minus the time waiting for IAS, i.e. enclave work and client I/O. */
+			Perf::LatencyHistogram m_handlerExclIas;
+
+			/** \brief	Upstream SigRL requests (i.e. not including SigRL cache hits). */
+			Perf::LatencyHistogram m_iasSigRl;
+
+			Perf::LatencyHistogram m_iasReport;
+
+			std::atomic<uint64_t> m_acceptedCnt;
+			std::atomic<uint64_t> m_activeCnt;
+			std::atomic<uint64_t> m_handledCnt;
+			std::atomic<uint64_t> m_failedCnt;
+			std::atomic<uint64_t> m_iasSigRlErrCnt;
+			std::atomic<uint64_t> m_iasReportErrCnt;
+			std::atomic<uint64_t> m_busyWorkers;
+			std::atomic<uint64_t> m_totalWorkers;
+			/** \brief	Connections turned away by admission control when accepted. */
+			std::atomic<uint64_t> m_admissionRejectedCnt;
+			/** \brief	Connections dropped by admission control because they would miss their deadline. */
+			std::atomic<uint64_t> m_deadlineShedCnt;
+			/** \brief	IAS requests failed after waiting too long for their turn. */
+			std::atomic<uint64_t> m_iasThrottledCnt;
+
+			/**
+			 * \brief	Sets the SigRL cache, whose counters will be included in the outputs.
+			 *
+			 * \param	sigRlCache	The SigRL cache; may be nullptr.
+			 */
+			void SetSigRlCache(std::shared_ptr<const CachedIasConnector> sigRlCache);
+
+			/**
+			 * \brief	Sets where the heap usage of the enclave comes from; it will be included in the
+			 * 			outputs.
+			 *
+			 * \param	getter	Gets the heap usage; may be empty.
+			 */
+			void SetEnclaveHeapStats(std::function<EnclaveHeapStats()> getter);
+
+			std::string ToJson() const;
+
+			/**
+			 * \brief	Outputs the metrics in Prometheus text exposition format.
+			 *
+			 * \return	The text.
+			 */
+			std::string ToPrometheus() const;
+
+			/**
+			 * \brief	Adds to the time the current thread has been waiting for IAS. The handler uses it
+			 * 			to tell the IAS wait apart from the rest of a handshake.
+			 *
+			 * \param	us	The time, in microseconds.
+			 */
+			static void AddThreadIasTime(uint64_t us) noexcept;
+
+			/**
+			 * \brief	Gets and clears the time the current thread has been waiting for IAS.
+			 *
+			 * \return	The time, in microseconds.
+			 */
+			static uint64_t TakeThreadIasTime() noexcept;
+
+		private:
+			std::shared_ptr<const CachedIasConnector> m_sigRlCache;
+			std::function<EnclaveHeapStats()> m_heapStatsGetter;
+		};
+	}
+}
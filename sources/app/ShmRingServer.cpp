@@ -0,0 +1,163 @@
+#include "ShmRingServer.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "../CommonApp/ShmRingConnection.h"
+
+#ifdef __linux__
+#	include <poll.h>
+#	include <unistd.h>
+#	include <sys/un.h>
+#	include <sys/socket.h>
+#	include <sys/eventfd.h>
+#endif // __linux__
+
+using namespace Decent;
+using namespace Decent::ServerApp;
+using namespace Decent::ShmNet;
+
+#ifdef __linux__
+
+namespace
+{
+	static constexpr int gsk_listenBacklog = 256;
+}
+
+ShmRingServer::ShmRingServer(const std::string & serverName, size_t ringSize) :
+	m_ringSize(ringSize),
+	m_listenSocket(socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)),
+	m_wakeEvent(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+	m_isTerminated(false)
+{
+	const std::string address = ShmRingConnection::GetSocketAddress(serverName);
+
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	if (m_listenSocket < 0 || m_wakeEvent < 0 || address.size() > sizeof(addr.sun_path) ||
+		ringSize < ShmRingConnection::sk_minRingSize || ringSize > ShmRingConnection::sk_maxRingSize)
+	{
+		CloseAll();
+		throw std::runtime_error("Failed to set up the shared-memory server.");
+	}
+	std::memcpy(addr.sun_path, address.data(), address.size());
+
+	if (bind(m_listenSocket, reinterpret_cast<const sockaddr*>(&addr), static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + address.size())) != 0 ||
+		listen(m_listenSocket, gsk_listenBacklog) != 0)
+	{
+		CloseAll();
+		throw std::runtime_error("Failed to bind the shared-memory server to name " + serverName + ".");
+	}
+}
+
+ShmRingServer::~ShmRingServer()
+{
+	Terminate();
+	CloseAll();
+}
+
+std::unique_ptr<Net::ConnectionBase> ShmRingServer::AcceptConnection()
+{
+	while (!m_isTerminated)
+	{
+		pollfd pollFds[2] = {};
+		pollFds[0].fd = m_listenSocket;
+		pollFds[0].events = POLLIN;
+		pollFds[1].fd = m_wakeEvent;
+		pollFds[1].events = POLLIN;
+		if (poll(pollFds, 2, -1) < 0 && errno != EINTR)
+		{
+			return nullptr;
+		}
+		if (m_isTerminated || (pollFds[0].revents & POLLIN) == 0)
+		{
+			continue;
+		}
+
+		//Several threads may be woken for one client; the others go back to waiting.
+		const int socket = accept4(m_listenSocket, nullptr, nullptr, SOCK_CLOEXEC);
+		if (socket < 0)
+		{
+			continue;
+		}
+
+		try
+		{
+			return ShmRingConnection::Accept(socket, m_ringSize);
+		}
+		catch (const std::exception&)
+		{
+			//The client has failed the handshake; its socket is closed already.
+		}
+	}
+	return nullptr;
+}
+
+bool ShmRingServer::IsTerminated() const noexcept
+{
+	return m_isTerminated;
+}
+
+void ShmRingServer::Terminate() noexcept
+{
+	if (m_isTerminated.exchange(true))
+	{
+		return;
+	}
+
+	//Wakes up every thread waiting in AcceptConnection; the event is never reset.
+	if (m_wakeEvent >= 0)
+	{
+		const uint64_t one = 1;
+		const ssize_t writeSize = write(m_wakeEvent, &one, sizeof(one));
+		(void)writeSize;
+	}
+}
+
+void ShmRingServer::CloseAll() noexcept
+{
+	m_isTerminated = true;
+	for (int* fd : { &m_listenSocket, &m_wakeEvent })
+	{
+		if (*fd >= 0)
+		{
+			close(*fd);
+			*fd = -1;
+		}
+	}
+}
+
+#else
+
+ShmRingServer::ShmRingServer(const std::string & serverName, size_t ringSize) :
+	m_ringSize(ringSize),
+	m_listenSocket(-1),
+	m_wakeEvent(-1),
+	m_isTerminated(true)
+{
+	throw std::runtime_error("The shared-memory server is only supported on Linux.");
+}
+
+ShmRingServer::~ShmRingServer()
+{
+}
+
+std::unique_ptr<Net::ConnectionBase> ShmRingServer::AcceptConnection()
+{
+	return nullptr;
+}
+
+bool ShmRingServer::IsTerminated() const noexcept
+{
+	return true;
+}
+
+void ShmRingServer::Terminate() noexcept
+{
+}
+
+void ShmRingServer::CloseAll() noexcept
+{
+}
+
+#endif // __linux__
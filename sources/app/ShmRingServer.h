@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <memory>
+#include <cstddef>
+
+#include <DecentApi/CommonApp/Net/Server.h>
+
+namespace Decent
+{
+	namespace ServerApp
+	{
+		/**
+		 * \brief	A server for clients on the same host, whose connections are ShmNet::ShmRingConnection
+		 * 			(Linux only). Clients find it by name, through a Unix domain socket in the abstract
+		 * 			namespace, and then exchange messages over shared memory.
+		 */
+		class ShmRingServer : public Net::Server
+		{
+		public:
+			/**
+			 * \brief	Constructor
+			 *
+			 * \exception	std::runtime_error	Thrown if the socket can't be set up (e.g. the name is
+			 * 									taken), or on other platforms.
+			 *
+			 * \param	serverName	Name of the server.
+			 * \param	ringSize  	Size of each ring of a connection; a power of two.
+			 */
+			ShmRingServer(const std::string& serverName, size_t ringSize);
+
+			virtual ~ShmRingServer();
+
+			/**
+			 * \brief	Waits for a client and sets up its shared-memory segment. Clients failing the
+			 * 			handshake are dropped.
+			 *
+			 * \return	The connection, or nullptr if the server is terminated.
+			 */
+			virtual std::unique_ptr<Net::ConnectionBase> AcceptConnection() override;
+
+			virtual bool IsTerminated() const noexcept override;
+
+			virtual void Terminate() noexcept override;
+
+		private:
+			void CloseAll() noexcept;
+
+			const size_t m_ringSize;
+			int m_listenSocket;
+			int m_wakeEvent;
+			std::atomic<bool> m_isTerminated;
+		};
+	}
+}
@@ -0,0 +1,74 @@
+#include "StartupTimeline.h"
+
+#include <algorithm>
+
+#include <DecentApi/Common/Common.h>
+
+using namespace Decent;
+using namespace Decent::ServerApp;
+
+namespace
+{
+	static long long ToMilliseconds(StartupTimeline::Clock::duration duration)
+	{
+		return static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(duration).count());
+	}
+}
+
+StartupTimeline::Phase::Phase(StartupTimeline & timeline, const std::string & name) :
+	m_timeline(timeline),
+	m_name(name),
+	m_start(Clock::now()),
+	m_isEnded(false)
+{
+}
+
+StartupTimeline::Phase::~Phase()
+{
+	End();
+}
+
+void StartupTimeline::Phase::End()
+{
+	if (m_isEnded)
+	{
+		return;
+	}
+	m_isEnded = true;
+	m_timeline.Record(m_name, m_start, Clock::now());
+}
+
+StartupTimeline::StartupTimeline() :
+	m_origin(Clock::now()),
+	m_mutex(),
+	m_records()
+{
+}
+
+StartupTimeline::~StartupTimeline()
+{
+}
+
+void StartupTimeline::Record(const std::string & name, Clock::time_point start, Clock::time_point end)
+{
+	std::unique_lock<std::mutex> recordsLock(m_mutex);
+	m_records.push_back(PhaseRecord{ name, start - m_origin, end - start });
+}
+
+void StartupTimeline::Print() const
+{
+	std::vector<PhaseRecord> records;
+	{
+		std::unique_lock<std::mutex> recordsLock(m_mutex);
+		records = m_records;
+	}
+	std::stable_sort(records.begin(), records.end(),
+		[](const PhaseRecord& a, const PhaseRecord& b) { return a.m_start < b.m_start; });
+
+	PRINT_I("Startup finished in %lld ms:", ToMilliseconds(Clock::now() - m_origin));
+	for (const PhaseRecord& record : records)
+	{
+		PRINT_I("\t%-24s starts at %6lld ms, takes %6lld ms.", record.m_name.c_str(),
+			ToMilliseconds(record.m_start), ToMilliseconds(record.m_duration));
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace Decent
+{
+	namespace ServerApp
+	{
+		/**
+		 * \brief	Records when each startup phase begins and ends, relative to the creation of the
+		 * 			timeline, so that phases running on different threads can be compared. Thread-safe.
+		 */
+		class StartupTimeline
+		{
+		public:
+			typedef std::chrono::steady_clock Clock;
+
+			/** \brief	Records a phase from its construction to its destruction (or to End()). */
+			class Phase
+			{
+			public:
+				Phase(StartupTimeline& timeline, const std::string& name);
+
+				Phase(const Phase& rhs) = delete;
+
+				virtual ~Phase();
+
+				/** \brief	Ends the phase now; later calls have no effect. */
+				void End();
+
+			private:
+				StartupTimeline& m_timeline;
+				const std::string m_name;
+				const Clock::time_point m_start;
+				bool m_isEnded;
+			};
+
+		public:
+			StartupTimeline();
+
+			virtual ~StartupTimeline();
+
+			/**
+			 * \brief	Records a finished phase.
+			 *
+			 * \param	name 	The name of the phase.
+			 * \param	start	The start time.
+			 * \param	end  	The end time.
+			 */
+			void Record(const std::string& name, Clock::time_point start, Clock::time_point end);
+
+			/**
+			 * \brief	Prints the phases, in the order they started, and the total time since the
+			 * 			timeline is created.
+			 */
+			void Print() const;
+
+		private:
+			struct PhaseRecord
+			{
+				std::string m_name;
+				Clock::duration m_start;
+				Clock::duration m_duration;
+			};
+
+			const Clock::time_point m_origin;
+
+			mutable std::mutex m_mutex;
+			std::vector<PhaseRecord> m_records;
+		};
+	}
+}
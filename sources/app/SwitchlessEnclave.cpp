@@ -0,0 +1,67 @@
+#include "SwitchlessEnclave.h"
+
+#include <atomic>
+#include <stdexcept>
+
+#include <sgx_urts.h>
+#include <sgx_uswitchless.h>
+
+using namespace Decent;
+using namespace Decent::ServerApp;
+
+namespace
+{
+	static std::atomic<bool> gs_switchlessEnabled(false);
+	static sgx_uswitchless_config_t gs_switchlessConfig = SGX_USWITCHLESS_CONFIG_INITIALIZER;
+}
+
+#ifdef DECENT_SERVER_WRAP_CREATE_ENCLAVE
+
+extern "C" sgx_status_t __real_sgx_create_enclave(const char* file_name, const int debug, sgx_launch_token_t* launch_token,
+	int* launch_token_updated, sgx_enclave_id_t* enclave_id, sgx_misc_attribute_t* misc_attr);
+
+/**
+ * \brief	Replaces sgx_create_enclave (with the linker's --wrap option), so that enclaves created by the
+ * 			Decent API are created with the switchless configuration, once it's enabled.
+ */
+extern "C" sgx_status_t __wrap_sgx_create_enclave(const char* file_name, const int debug, sgx_launch_token_t* launch_token,
+	int* launch_token_updated, sgx_enclave_id_t* enclave_id, sgx_misc_attribute_t* misc_attr)
+{
+	if (!gs_switchlessEnabled)
+	{
+		return __real_sgx_create_enclave(file_name, debug, launch_token, launch_token_updated, enclave_id, misc_attr);
+	}
+
+	const void* exFeatures[32] = { nullptr };
+	exFeatures[SGX_CREATE_ENCLAVE_EX_SWITCHLESS_BIT_IDX] = &gs_switchlessConfig;
+
+	return sgx_create_enclave_ex(file_name, debug, launch_token, launch_token_updated, enclave_id, misc_attr,
+		SGX_CREATE_ENCLAVE_EX_SWITCHLESS, exFeatures);
+}
+
+bool ServerApp::IsSwitchlessSupported() noexcept
+{
+	return true;
+}
+
+#else
+
+bool ServerApp::IsSwitchlessSupported() noexcept
+{
+	return false;
+}
+
+#endif // DECENT_SERVER_WRAP_CREATE_ENCLAVE
+
+void ServerApp::EnableSwitchless(size_t untrustedWorkers, size_t trustedWorkers)
+{
+	if (!IsSwitchlessSupported())
+	{
+		throw std::runtime_error("Switchless mode is not supported in this build.");
+	}
+
+	gs_switchlessConfig.num_uworkers = static_cast<uint32_t>(untrustedWorkers);
+	gs_switchlessConfig.num_tworkers = static_cast<uint32_t>(trustedWorkers);
+
+	gs_switchlessEnabled = true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Decent
+{
+	namespace ServerApp
+	{
+		/**
+		 * \brief	Query if switchless mode can be turned on in this build. Enclaves are created by the
+		 * 			Decent API, so it's only possible when the linker wraps sgx_create_enclave (i.e.
+		 * 			DECENT_SERVER_WRAP_CREATE_ENCLAVE is defined).
+		 *
+		 * \return	True if switchless is supported, false if not.
+		 */
+		bool IsSwitchlessSupported() noexcept;
+
+		/**
+		 * \brief	Turn on switchless mode for all enclaves created after this call. Calls declared with
+		 * 			transition_using_threads in the EDL will then be served by worker threads, instead
+		 * 			of leaving/entering the enclave.
+		 *
+		 * \exception	std::runtime_error	Thrown if switchless is not supported in this build.
+		 *
+		 * \param	untrustedWorkers	Number of untrusted workers, which serve switchless OCALLs.
+		 * \param	trustedWorkers  	Number of trusted workers, which serve switchless ECALLs.
+		 */
+		void EnableSwitchless(size_t untrustedWorkers, size_t trustedWorkers);
+	}
+}
@@ -0,0 +1,71 @@
+#include "ThrottledIasConnector.h"
+
+#include <stdexcept>
+
+#include "ServerMetrics.h"
+
+using namespace Decent;
+using namespace Decent::ServerApp;
+
+ThrottledIasConnector::SlotGuard::SlotGuard(const ThrottledIasConnector & parent) :
+	m_parent(parent)
+{
+	const Clock::time_point start = Clock::now();
+
+	std::unique_lock<std::mutex> lock(m_parent.m_mutex);
+	const bool isFree = m_parent.m_signal.wait_for(lock, m_parent.m_maxWait,
+		[this]() { return m_parent.m_inFlight < m_parent.m_maxInFlight; });
+
+	//Waiting for a slot is part of waiting for IAS.
+	ServerMetrics::AddThreadIasTime(static_cast<uint64_t>(
+		std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count()));
+
+	if (!isFree)
+	{
+		m_parent.m_metrics->m_iasThrottledCnt.fetch_add(1, std::memory_order_relaxed);
+		throw std::runtime_error("Too many IAS requests in flight.");
+	}
+	++m_parent.m_inFlight;
+}
+
+ThrottledIasConnector::SlotGuard::~SlotGuard()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_parent.m_mutex);
+		--m_parent.m_inFlight;
+	}
+	m_parent.m_signal.notify_one();
+}
+
+ThrottledIasConnector::ThrottledIasConnector(std::shared_ptr<Ias::Connector> upstream, const std::string & subscriptionKey,
+	size_t maxInFlight, Clock::duration maxWait, std::shared_ptr<ServerMetrics> metrics) :
+	Ias::Connector(subscriptionKey),
+	m_upstream(upstream),
+	m_maxInFlight(maxInFlight),
+	m_maxWait(maxWait),
+	m_metrics(metrics),
+	m_mutex(),
+	m_signal(),
+	m_inFlight(0)
+{
+	if (m_maxInFlight == 0)
+	{
+		throw std::invalid_argument("The number of IAS requests in flight must be positive.");
+	}
+}
+
+ThrottledIasConnector::~ThrottledIasConnector()
+{
+}
+
+std::string ThrottledIasConnector::GetSigRl(const sgx_epid_group_id_t & gid) const
+{
+	SlotGuard slot(*this);
+	return m_upstream->GetSigRl(gid);
+}
+
+void ThrottledIasConnector::GetQuoteReport(const std::string & jsonReqBody, std::string & outReport, std::string & outSign, std::string & outCert) const
+{
+	SlotGuard slot(*this);
+	m_upstream->GetQuoteReport(jsonReqBody, outReport, outSign, outCert);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <condition_variable>
+
+#include <DecentApi/CommonApp/SGX/IasConnector.h>
+
+namespace Decent
+{
+	namespace ServerApp
+	{
+		class ServerMetrics;
+
+		/**
+		 * \brief	An IAS connector that limits the number of requests in flight to the upstream
+		 * 			connector. When IAS slows down, extra requests wait here for a limited time and then
+		 * 			fail, instead of piling up on IAS and holding every worker.
+		 */
+		class ThrottledIasConnector : public Ias::Connector
+		{
+		public:
+			typedef std::chrono::steady_clock Clock;
+
+		public:
+			/**
+			 * \brief	Constructor
+			 *
+			 * \param	upstream	   	The connector that actually talks to IAS.
+			 * \param	subscriptionKey	The IAS subscription key (only used by the base class).
+			 * \param	maxInFlight	   	Maximum number of requests in flight; must be positive.
+			 * \param	maxWait		   	How long a request waits for its turn before it fails.
+			 * \param	metrics		   	The metrics to update.
+			 */
+			ThrottledIasConnector(std::shared_ptr<Ias::Connector> upstream, const std::string& subscriptionKey,
+				size_t maxInFlight, Clock::duration maxWait, std::shared_ptr<ServerMetrics> metrics);
+
+			virtual ~ThrottledIasConnector();
+
+			/**
+			 * \exception	std::runtime_error	Thrown if it waited too long for its turn.
+			 */
+			virtual std::string GetSigRl(const sgx_epid_group_id_t& gid) const override;
+
+			/**
+			 * \exception	std::runtime_error	Thrown if it waited too long for its turn.
+			 */
+			virtual void GetQuoteReport(const std::string& jsonReqBody, std::string& outReport, std::string& outSign, std::string& outCert) const override;
+
+		private:
+			/** \brief	Takes a slot for the lifetime of the request. */
+			class SlotGuard
+			{
+			public:
+				SlotGuard(const ThrottledIasConnector& parent);
+
+				~SlotGuard();
+
+			private:
+				const ThrottledIasConnector& m_parent;
+			};
+
+			std::shared_ptr<Ias::Connector> m_upstream;
+			const size_t m_maxInFlight;
+			const Clock::duration m_maxWait;
+			std::shared_ptr<ServerMetrics> m_metrics;
+
+			mutable std::mutex m_mutex;
+			mutable std::condition_variable m_signal;
+			mutable size_t m_inFlight;
+		};
+	}
+}
@@ -0,0 +1,106 @@
+#include "TrackedServer.h"
+
+#include "../CommonApp/Tracer.h"
+
+#include "ServerMetrics.h"
+#include "AdmissionController.h"
+
+using namespace Decent;
+using namespace Decent::ServerApp;
+using namespace Decent::Perf;
+
+TrackedConnection::TrackedConnection(std::unique_ptr<Net::ConnectionBase> connection, std::shared_ptr<ServerMetrics> metrics,
+	std::shared_ptr<AdmissionController> admission) :
+	m_connection(std::move(connection)),
+	m_metrics(metrics),
+	m_admission(admission),
+	m_acceptTime(Clock::now()),
+	m_isHandled(false),
+	m_isAdmitted(m_admission != nullptr),
+	m_traceId(Tracer::GetInstance().IsEnabled() ? Tracer::NewTraceId() : 0)
+{
+	m_metrics->m_acceptedCnt.fetch_add(1, std::memory_order_relaxed);
+	m_metrics->m_activeCnt.fetch_add(1, std::memory_order_relaxed);
+
+	Tracer::GetInstance().RecordInstant("Accept", m_traceId);
+}
+
+TrackedConnection::~TrackedConnection()
+{
+	LeaveAdmission();
+	m_metrics->m_activeCnt.fetch_sub(1, std::memory_order_relaxed);
+}
+
+size_t TrackedConnection::SendRaw(const void * const dataPtr, const size_t size)
+{
+	TraceSpan span("Send");
+	return m_connection->SendRaw(dataPtr, size);
+}
+
+size_t TrackedConnection::RecvRaw(void * const bufPtr, const size_t size)
+{
+	return m_connection->RecvRaw(bufPtr, size);
+}
+
+void TrackedConnection::Terminate() noexcept
+{
+	m_connection->Terminate();
+}
+
+bool TrackedConnection::TakeFirstMessage() noexcept
+{
+	const bool isFirst = !m_isHandled;
+	m_isHandled = true;
+	return isFirst;
+}
+
+void TrackedConnection::LeaveAdmission() noexcept
+{
+	if (m_isAdmitted)
+	{
+		m_isAdmitted = false;
+		m_admission->Leave();
+	}
+}
+
+TrackedServer::TrackedServer(std::unique_ptr<Net::Server> server, std::shared_ptr<ServerMetrics> metrics,
+	std::shared_ptr<AdmissionController> admission) :
+	m_server(std::move(server)),
+	m_metrics(metrics),
+	m_admission(admission)
+{
+}
+
+TrackedServer::~TrackedServer()
+{
+}
+
+std::unique_ptr<Net::ConnectionBase> TrackedServer::AcceptConnection()
+{
+	while (true)
+	{
+		std::unique_ptr<Net::ConnectionBase> connection = m_server->AcceptConnection();
+		if (!connection)
+		{
+			return nullptr;
+		}
+
+		if (!m_admission || m_admission->TryEnter())
+		{
+			return std::make_unique<TrackedConnection>(std::move(connection), m_metrics, m_admission);
+		}
+
+		//Turned away before it costs a worker anything.
+		m_admission->RejectConnection(*connection);
+	}
+}
+
+bool TrackedServer::IsTerminated() const noexcept
+{
+	return m_server->IsTerminated();
+}
+
+void TrackedServer::Terminate() noexcept
+{
+	m_server->Terminate();
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <cstdint>
+
+#include <DecentApi/CommonApp/Net/Server.h>
+
+namespace Decent
+{
+	namespace ServerApp
+	{
+		class ServerMetrics;
+		class AdmissionController;
+
+		/**
+		 * \brief	A connection accepted by TrackedServer. It remembers when it was accepted, and keeps
+		 * 			the active connection count of the metrics; everything else is forwarded to the
+		 * 			underlying connection. If it was let in by an admission controller, it stays in the
+		 * 			system until LeaveAdmission() is called or it's destroyed.
+		 */
+		class TrackedConnection : public Net::ConnectionBase
+		{
+		public:
+			typedef std::chrono::steady_clock Clock;
+
+		public:
+			TrackedConnection(std::unique_ptr<Net::ConnectionBase> connection, std::shared_ptr<ServerMetrics> metrics,
+				std::shared_ptr<AdmissionController> admission);
+
+			virtual ~TrackedConnection();
+
+			virtual size_t SendRaw(const void* const dataPtr, const size_t size) override;
+
+			virtual size_t RecvRaw(void* const bufPtr, const size_t size) override;
+
+			virtual void Terminate() noexcept override;
+
+			Clock::time_point GetAcceptTime() const noexcept { return m_acceptTime; }
+
+			/**
+			 * \brief	Checks if the connection hasn't been handled yet, and marks it as handled. Only the
+			 * 			first message of a kept-alive connection has waited in the queue since accepted.
+			 *
+			 * \return	True if it's the first message on this connection.
+			 */
+			bool TakeFirstMessage() noexcept;
+
+			/**
+			 * \brief	Gets the admission controller that let this connection in.
+			 *
+			 * \return	The admission controller, or nullptr if there is none.
+			 */
+			AdmissionController* GetAdmission() const noexcept { return m_admission.get(); }
+
+			/** \brief	Leaves the admission controller's system; calling it again has no effect. */
+			void LeaveAdmission() noexcept;
+
+			/**
+			 * \brief	Gets the ID tying the trace spans of this connection together.
+			 *
+			 * \return	The trace ID, or zero if tracing was off when it was accepted.
+			 */
+			uint64_t GetTraceId() const noexcept { return m_traceId; }
+
+		private:
+			std::unique_ptr<Net::ConnectionBase> m_connection;
+			std::shared_ptr<ServerMetrics> m_metrics;
+			std::shared_ptr<AdmissionController> m_admission;
+			const Clock::time_point m_acceptTime;
+			bool m_isHandled;
+			bool m_isAdmitted;
+			const uint64_t m_traceId;
+		};
+
+		/**
+		 * \brief	A server wrapping each accepted connection in a TrackedConnection. Handlers given to
+		 * 			the smart server together with this server can rely on that. Connections turned away
+		 * 			by the admission controller, if any, get the busy reply and are closed right away.
+		 */
+		class TrackedServer : public Net::Server
+		{
+		public:
+			/**
+			 * \brief	Constructor
+			 *
+			 * \param	server   	The underlying server.
+			 * \param	metrics  	The metrics to update.
+			 * \param	admission	The admission controller; may be nullptr to let every connection in.
+			 */
+			TrackedServer(std::unique_ptr<Net::Server> server, std::shared_ptr<ServerMetrics> metrics,
+				std::shared_ptr<AdmissionController> admission);
+
+			virtual ~TrackedServer();
+
+			virtual std::unique_ptr<Net::ConnectionBase> AcceptConnection() override;
+
+			virtual bool IsTerminated() const noexcept override;
+
+			virtual void Terminate() noexcept override;
+
+		private:
+			std::unique_ptr<Net::Server> m_server;
+			std::shared_ptr<ServerMetrics> m_metrics;
+			std::shared_ptr<AdmissionController> m_admission;
+		};
+	}
+}
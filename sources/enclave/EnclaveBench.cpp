@@ -0,0 +1,290 @@
+#include <cstdint>
+
+#ifdef DECENT_SERVER_ENCLAVE_BENCH
+#	include <vector>
+#	include <string>
+#	include <cstddef>
+#	include <cstring>
+#	include <stdexcept>
+
+#	include <sgx_trts.h>
+#	include <sgx_quote.h>
+
+#	include <mbedtls/pk.h>
+#	include <mbedtls/md.h>
+#	include <mbedtls/ecp.h>
+#	include <mbedtls/base64.h>
+#	include <mbedtls/bignum.h>
+#	include <mbedtls/x509_crt.h>
+#endif // DECENT_SERVER_ENCLAVE_BENCH
+
+#include "Enclave_t.h"
+
+#ifdef DECENT_SERVER_ENCLAVE_BENCH
+
+namespace
+{
+	static constexpr char const gsk_benchName[] = "CN=Decent Server Bench";
+	static constexpr size_t gsk_maxCertSize = 2048;
+
+	static int SgxRand(void*, unsigned char* buf, size_t len)
+	{
+		return sgx_read_rand(buf, len) == SGX_SUCCESS ? 0 : MBEDTLS_ERR_ECP_RANDOM_FAILED;
+	}
+
+	/**
+	 * \brief	Issues a certificate for the key, signed by the key itself, i.e. the same signing work as
+	 * 			issuing a certificate after a handshake.
+	 *
+	 * \exception	std::runtime_error	Thrown if mbedTLS fails.
+	 *
+	 * \param [in,out]	key	The key.
+	 *
+	 * \return	Size of the certificate in DER.
+	 */
+	static size_t IssueCert(mbedtls_pk_context& key)
+	{
+		mbedtls_x509write_cert crt;
+		mbedtls_mpi serial;
+		mbedtls_x509write_crt_init(&crt);
+		mbedtls_mpi_init(&serial);
+
+		unsigned char buf[gsk_maxCertSize];
+		mbedtls_x509write_crt_set_version(&crt, MBEDTLS_X509_CRT_VERSION_3);
+		mbedtls_x509write_crt_set_md_alg(&crt, MBEDTLS_MD_SHA256);
+		mbedtls_x509write_crt_set_subject_key(&crt, &key);
+		mbedtls_x509write_crt_set_issuer_key(&crt, &key);
+		const int ret = (mbedtls_x509write_crt_set_subject_name(&crt, gsk_benchName) != 0 ||
+			mbedtls_x509write_crt_set_issuer_name(&crt, gsk_benchName) != 0 ||
+			mbedtls_mpi_lset(&serial, 1) != 0 ||
+			mbedtls_x509write_crt_set_serial(&crt, &serial) != 0 ||
+			mbedtls_x509write_crt_set_validity(&crt, "20200101000000", "20301231235959") != 0) ?
+			-1 : mbedtls_x509write_crt_der(&crt, buf, sizeof(buf), &SgxRand, nullptr);
+
+		mbedtls_mpi_free(&serial);
+		mbedtls_x509write_crt_free(&crt);
+
+		if (ret <= 0)
+		{
+			throw std::runtime_error("Failed to issue the benchmark certificate.");
+		}
+		return static_cast<size_t>(ret);
+	}
+
+	/**
+	 * \brief	The benchmark signing key, kept for the lifetime of the enclave like the server's own
+	 * 			key. Its DER encoding is kept too, to measure signing with a freshly loaded key.
+	 */
+	class BenchKey
+	{
+	public:
+		BenchKey() :
+			m_key(),
+			m_der()
+		{
+			mbedtls_pk_init(&m_key);
+
+			unsigned char buf[gsk_maxCertSize];
+			int derLen = 0;
+			if (mbedtls_pk_setup(&m_key, mbedtls_pk_info_from_type(MBEDTLS_PK_ECKEY)) != 0 ||
+				mbedtls_ecp_gen_key(MBEDTLS_ECP_DP_SECP256R1, mbedtls_pk_ec(m_key), &SgxRand, nullptr) != 0 ||
+				(derLen = mbedtls_pk_write_key_der(&m_key, buf, sizeof(buf))) <= 0)
+			{
+				mbedtls_pk_free(&m_key);
+				throw std::runtime_error("Failed to generate the benchmark key.");
+			}
+			//The DER is written at the end of the buffer.
+			m_der.assign(buf + sizeof(buf) - derLen, buf + sizeof(buf));
+
+			//The comb table is built by the first signature; do it now, rather than racing on it later.
+			IssueCert(m_key);
+		}
+
+		~BenchKey()
+		{
+			mbedtls_pk_free(&m_key);
+		}
+
+		mbedtls_pk_context& GetKey() noexcept { return m_key; }
+
+		const std::vector<unsigned char>& GetDer() const noexcept { return m_der; }
+
+	private:
+		mbedtls_pk_context m_key;
+		std::vector<unsigned char> m_der;
+	};
+
+	static BenchKey& GetBenchKey()
+	{
+		static BenchKey inst;
+		return inst;
+	}
+
+	/** \brief	Issues a certificate with a key loaded just for it, whose comb table is built again. */
+	static size_t IssueCertWithFreshKey(const std::vector<unsigned char>& der)
+	{
+		mbedtls_pk_context key;
+		mbedtls_pk_init(&key);
+		if (mbedtls_pk_parse_key(&key, der.data(), der.size(), nullptr, 0) != 0)
+		{
+			mbedtls_pk_free(&key);
+			throw std::runtime_error("Failed to load the benchmark key.");
+		}
+
+		try
+		{
+			const size_t res = IssueCert(key);
+			mbedtls_pk_free(&key);
+			return res;
+		}
+		catch (...)
+		{
+			mbedtls_pk_free(&key);
+			throw;
+		}
+	}
+
+	static std::vector<unsigned char> DecodeBase64(const char* begin, size_t len)
+	{
+		std::vector<unsigned char> res((len / 4 + 1) * 3);
+		size_t decodedLen = 0;
+		if (mbedtls_base64_decode(res.data(), res.size(), &decodedLen, reinterpret_cast<const unsigned char*>(begin), len) != 0)
+		{
+			throw std::runtime_error("Invalid base64 string.");
+		}
+		res.resize(decodedLen);
+		return res;
+	}
+
+	/**
+	 * \brief	Verifies an IAS attestation report the way a handshake does: the signing certificate
+	 * 			chain, the report signature, and the decoding of the quote body. The root of the chain
+	 * 			is taken as trusted.
+	 *
+	 * \exception	std::runtime_error	Thrown if the inputs can't be parsed.
+	 *
+	 * \return	True if the report is valid.
+	 */
+	static bool VerifyReport(const char* report, const char* signature, const char* certChain)
+	{
+		static constexpr char const sk_quoteBodyKey[] = "\"isvEnclaveQuoteBody\":\"";
+
+		mbedtls_x509_crt chain;
+		mbedtls_x509_crt_init(&chain);
+		bool isValid = false;
+		try
+		{
+			if (mbedtls_x509_crt_parse(&chain, reinterpret_cast<const unsigned char*>(certChain), std::strlen(certChain) + 1) != 0 ||
+				chain.next == nullptr)
+			{
+				throw std::runtime_error("Invalid report signing certificate chain.");
+			}
+
+			uint32_t verifyFlags = 0;
+			const bool isChainValid = mbedtls_x509_crt_verify(&chain, chain.next, nullptr, nullptr, &verifyFlags, nullptr, nullptr) == 0;
+
+			const std::vector<unsigned char> sign = DecodeBase64(signature, std::strlen(signature));
+			unsigned char hash[32];
+			if (mbedtls_md(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), reinterpret_cast<const unsigned char*>(report), std::strlen(report), hash) != 0)
+			{
+				throw std::runtime_error("Failed to hash the report.");
+			}
+			const bool isSignValid = mbedtls_pk_verify(&chain.pk, MBEDTLS_MD_SHA256, hash, sizeof(hash), sign.data(), sign.size()) == 0;
+
+			const char* bodyBegin = std::strstr(report, sk_quoteBodyKey);
+			const char* bodyEnd = bodyBegin ? std::strchr(bodyBegin + sizeof(sk_quoteBodyKey) - 1, '"') : nullptr;
+			if (!bodyEnd)
+			{
+				throw std::runtime_error("The report has no quote body.");
+			}
+			bodyBegin += sizeof(sk_quoteBodyKey) - 1;
+			const std::vector<unsigned char> quoteBody = DecodeBase64(bodyBegin, bodyEnd - bodyBegin);
+
+			isValid = isChainValid && isSignValid && quoteBody.size() >= offsetof(sgx_quote_t, signature_len);
+		}
+		catch (...)
+		{
+			mbedtls_x509_crt_free(&chain);
+			throw;
+		}
+		mbedtls_x509_crt_free(&chain);
+		return isValid;
+	}
+}
+
+#endif // DECENT_SERVER_ENCLAVE_BENCH
+
+/* Benchmark ECALLs. They fail (return 0) if the enclave is built without DECENT_SERVER_ENCLAVE_BENCH. */
+
+extern "C" int ecall_decent_server_bench_nop()
+{
+#ifdef DECENT_SERVER_ENCLAVE_BENCH
+	return 1;
+#else
+	return 0;
+#endif // DECENT_SERVER_ENCLAVE_BENCH
+}
+
+extern "C" int ecall_decent_server_bench_ocall(uint64_t count)
+{
+#ifdef DECENT_SERVER_ENCLAVE_BENCH
+	for (uint64_t i = 0; i < count; ++i)
+	{
+		if (ocall_decent_server_bench_nop() != SGX_SUCCESS)
+		{
+			return 0;
+		}
+	}
+	return 1;
+#else
+	return 0;
+#endif // DECENT_SERVER_ENCLAVE_BENCH
+}
+
+extern "C" int ecall_decent_server_bench_cert_sign(uint64_t count, int is_fresh_key, uint64_t* out_size)
+{
+	*out_size = 0;
+#ifdef DECENT_SERVER_ENCLAVE_BENCH
+	try
+	{
+		BenchKey& benchKey = GetBenchKey();
+
+		uint64_t totalSize = 0;
+		for (uint64_t i = 0; i < count; ++i)
+		{
+			totalSize += is_fresh_key ? IssueCertWithFreshKey(benchKey.GetDer()) : IssueCert(benchKey.GetKey());
+		}
+		*out_size = totalSize;
+		return 1;
+	}
+	catch (const std::exception&)
+	{
+		return 0;
+	}
+#else
+	return 0;
+#endif // DECENT_SERVER_ENCLAVE_BENCH
+}
+
+extern "C" int ecall_decent_server_bench_verify_report(uint64_t count, const char* report, const char* signature, const char* cert_chain, int* out_is_valid)
+{
+	*out_is_valid = 0;
+#ifdef DECENT_SERVER_ENCLAVE_BENCH
+	try
+	{
+		bool isValid = true;
+		for (uint64_t i = 0; i < count; ++i)
+		{
+			isValid = VerifyReport(report, signature, cert_chain) && isValid;
+		}
+		*out_is_valid = isValid ? 1 : 0;
+		return 1;
+	}
+	catch (const std::exception&)
+	{
+		return 0;
+	}
+#else
+	return 0;
+#endif // DECENT_SERVER_ENCLAVE_BENCH
+}
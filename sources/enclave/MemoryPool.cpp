@@ -0,0 +1,463 @@
+#include "MemoryPool.h"
+
+#include <new>
+#include <cstdlib>
+
+#include "Enclave_t.h"
+
+using namespace Decent;
+using namespace Decent::ServerEnclave;
+
+constexpr size_t MemoryPool::sk_minClassSize;
+constexpr size_t MemoryPool::sk_maxClassSize;
+constexpr size_t MemoryPool::sk_classNum;
+constexpr size_t MemoryPool::sk_pageSize;
+constexpr size_t MemoryPool::sk_chunkSize;
+constexpr size_t MemoryPool::sk_maxChunkNum;
+constexpr size_t MemoryPool::sk_chunkPageNum;
+
+struct MemoryPool::LargeHeader
+{
+	uint64_t m_size;    //Size requested.
+	uint64_t m_padding; //Keeps the 16-byte alignment of malloc.
+};
+
+struct MemoryPool::FreeBlock
+{
+	FreeBlock* m_next;
+};
+
+namespace
+{
+	//Highest and lowest stack pointers seen at allocations on the current TCS, over every ECALL made on
+	//it. The handshake ECALLs belong to the Decent API, so they can't be reset on entry; but every ECALL
+	//starts from the same stack base of its TCS, so the spread is still within the stack that TCS used.
+	static thread_local uintptr_t gs_stackTop = 0;
+	static thread_local uintptr_t gs_stackLow = UINTPTR_MAX;
+
+	//Constant-initialized, so it's ready before any static constructor calls operator new.
+	static MemoryPool gs_memoryPool;
+
+	static void UpdatePeak(std::atomic<uint64_t>& peak, uint64_t val) noexcept
+	{
+		uint64_t prev = peak.load(std::memory_order_relaxed);
+		while (val > prev && !peak.compare_exchange_weak(prev, val, std::memory_order_relaxed))
+		{}
+	}
+
+	class SpinLockGuard
+	{
+	public:
+		SpinLockGuard(std::atomic<bool>& lock) noexcept :
+			m_lock(lock)
+		{
+			while (m_lock.exchange(true, std::memory_order_acquire))
+			{}
+		}
+
+		~SpinLockGuard()
+		{
+			m_lock.store(false, std::memory_order_release);
+		}
+
+	private:
+		std::atomic<bool>& m_lock;
+	};
+}
+
+size_t MemoryPool::GetClassIndex(size_t size) noexcept
+{
+	static_assert(sizeof(LargeHeader) == 16, "Large blocks must keep the 16-byte alignment of malloc.");
+	static_assert(sk_chunkSize % sk_pageSize == 0 && sk_pageSize % sk_maxClassSize == 0, "Pages must be filled up by blocks.");
+
+	size_t classIdx = 0;
+	for (size_t classSize = sk_minClassSize; classSize < size && classIdx < sk_classNum; classSize <<= 1)
+	{
+		++classIdx;
+	}
+	return classIdx;
+}
+
+size_t MemoryPool::GetClassSize(size_t classIdx) noexcept
+{
+	return sk_minClassSize << classIdx;
+}
+
+size_t MemoryPool::GetPageBlockNum(size_t classIdx) noexcept
+{
+	return sk_pageSize / GetClassSize(classIdx);
+}
+
+void * MemoryPool::Allocate(size_t size) noexcept
+{
+	SampleStack();
+
+	const size_t classIdx = GetClassIndex(size);
+
+	void* ptr = nullptr;
+	uint64_t usedSize = 0;
+	if (classIdx < sk_classNum)
+	{
+		ptr = AllocateFromClass(classIdx);
+		usedSize = GetClassSize(classIdx);
+	}
+
+	if (ptr == nullptr && size <= SIZE_MAX - sizeof(LargeHeader))
+	{
+		LargeHeader* header = static_cast<LargeHeader*>(std::malloc(sizeof(LargeHeader) + size));
+		if (header != nullptr)
+		{
+			AddReserved(sizeof(LargeHeader) + size);
+			header->m_size = size;
+			ptr = header + 1;
+			usedSize = size;
+		}
+	}
+
+	if (ptr == nullptr)
+	{
+		m_failedCnt.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	UpdatePeak(m_peakInUse, m_inUse.fetch_add(usedSize, std::memory_order_relaxed) + usedSize);
+
+	return ptr;
+}
+
+void MemoryPool::Deallocate(void * ptr) noexcept
+{
+	if (ptr == nullptr)
+	{
+		return;
+	}
+
+	Page* page = FindPage(ptr);
+	if (page != nullptr)
+	{
+		//The page can't change its class while a block of it is in use.
+		m_inUse.fetch_sub(GetClassSize(page->m_classIdx), std::memory_order_relaxed);
+		DeallocateToPage(page, ptr);
+	}
+	else
+	{
+		LargeHeader* header = static_cast<LargeHeader*>(ptr) - 1;
+		m_inUse.fetch_sub(header->m_size, std::memory_order_relaxed);
+		m_reserved.fetch_sub(sizeof(LargeHeader) + header->m_size, std::memory_order_relaxed);
+		std::free(header);
+	}
+}
+
+HeapStats MemoryPool::GetStats() const noexcept
+{
+	HeapStats stats;
+	stats.m_inUse = m_inUse.load(std::memory_order_relaxed);
+	stats.m_peakInUse = m_peakInUse.load(std::memory_order_relaxed);
+	stats.m_reserved = m_reserved.load(std::memory_order_relaxed);
+	stats.m_peakReserved = m_peakReserved.load(std::memory_order_relaxed);
+	stats.m_failedCnt = m_failedCnt.load(std::memory_order_relaxed);
+	stats.m_peakStack = m_peakStack.load(std::memory_order_relaxed);
+	return stats;
+}
+
+MemoryPool::Page * MemoryPool::FindPage(const void * ptr) noexcept
+{
+	//A chunk is only given back to the heap once none of its blocks is in use, so the slot of the
+	//	chunk a block is in can't change while the block is being freed.
+	const uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+	const size_t chunkNum = m_chunkNum.load(std::memory_order_acquire);
+	for (size_t i = 0; i < chunkNum; ++i)
+	{
+		const uintptr_t begin = m_chunks[i].m_begin.load(std::memory_order_acquire);
+		if (begin != 0 && addr - begin < sk_chunkSize)
+		{
+			return &m_pages[i * sk_chunkPageNum + (addr - begin) / sk_pageSize];
+		}
+	}
+	return nullptr;
+}
+
+uint8_t * MemoryPool::GetPageMemory(const Page * page) const noexcept
+{
+	const size_t pageIdx = static_cast<size_t>(page - m_pages);
+	const uintptr_t begin = m_chunks[pageIdx / sk_chunkPageNum].m_begin.load(std::memory_order_relaxed);
+	return reinterpret_cast<uint8_t*>(begin) + (pageIdx % sk_chunkPageNum) * sk_pageSize;
+}
+
+void * MemoryPool::AllocateFromClass(size_t classIdx) noexcept
+{
+	SizeClass& sizeClass = m_classes[classIdx];
+	SpinLockGuard classLock(sizeClass.m_lock);
+
+	Page* page = sizeClass.m_roomyPages;
+	if (page == nullptr)
+	{
+		page = TakeFreePage();
+		if (page == nullptr)
+		{
+			return nullptr;
+		}
+		page->m_freeList = nullptr;
+		page->m_carvedNum = 0;
+		page->m_usedNum = 0;
+		page->m_classIdx = classIdx;
+		page->m_prev = nullptr;
+		page->m_next = nullptr;
+		sizeClass.m_roomyPages = page;
+	}
+
+	void* block = nullptr;
+	if (page->m_freeList != nullptr)
+	{
+		block = page->m_freeList;
+		page->m_freeList = page->m_freeList->m_next;
+	}
+	else
+	{
+		block = GetPageMemory(page) + page->m_carvedNum * GetClassSize(classIdx);
+		++page->m_carvedNum;
+	}
+
+	//A full page leaves the list; it's the head of it.
+	if (++page->m_usedNum == GetPageBlockNum(classIdx))
+	{
+		sizeClass.m_roomyPages = page->m_next;
+		if (page->m_next != nullptr)
+		{
+			page->m_next->m_prev = nullptr;
+		}
+		page->m_next = nullptr;
+	}
+
+	return block;
+}
+
+void MemoryPool::DeallocateToPage(Page * page, void * ptr) noexcept
+{
+	SizeClass& sizeClass = m_classes[page->m_classIdx];
+	SpinLockGuard classLock(sizeClass.m_lock);
+
+	FreeBlock* block = static_cast<FreeBlock*>(ptr);
+	block->m_next = page->m_freeList;
+	page->m_freeList = block;
+
+	if (page->m_usedNum-- == GetPageBlockNum(page->m_classIdx))
+	{
+		page->m_prev = nullptr;
+		page->m_next = sizeClass.m_roomyPages;
+		if (page->m_next != nullptr)
+		{
+			page->m_next->m_prev = page;
+		}
+		sizeClass.m_roomyPages = page;
+	}
+
+	if (page->m_usedNum == 0)
+	{
+		if (page->m_prev != nullptr)
+		{
+			page->m_prev->m_next = page->m_next;
+		}
+		else
+		{
+			sizeClass.m_roomyPages = page->m_next;
+		}
+		if (page->m_next != nullptr)
+		{
+			page->m_next->m_prev = page->m_prev;
+		}
+		GiveBackPage(page);
+	}
+}
+
+MemoryPool::Page * MemoryPool::TakeFreePage() noexcept
+{
+	SpinLockGuard arenaLock(m_arenaLock);
+
+	if (m_freePages == nullptr)
+	{
+		//Chunks are rarely taken, so the heap is called with the lock held.
+		const size_t chunkNum = m_chunkNum.load(std::memory_order_relaxed);
+		size_t chunkIdx = 0;
+		while (chunkIdx < chunkNum && m_chunks[chunkIdx].m_begin.load(std::memory_order_relaxed) != 0)
+		{
+			++chunkIdx;
+		}
+		if (chunkIdx == sk_maxChunkNum)
+		{
+			return nullptr;
+		}
+
+		void* chunkMem = std::malloc(sk_chunkSize);
+		if (chunkMem == nullptr)
+		{
+			return nullptr;
+		}
+		AddReserved(sk_chunkSize);
+
+		Chunk& chunk = m_chunks[chunkIdx];
+		chunk.m_begin.store(reinterpret_cast<uintptr_t>(chunkMem), std::memory_order_release);
+		chunk.m_freePageNum = sk_chunkPageNum;
+		if (chunkIdx == chunkNum)
+		{
+			m_chunkNum.store(chunkNum + 1, std::memory_order_release);
+		}
+
+		for (size_t i = 0; i < sk_chunkPageNum; ++i)
+		{
+			Page& page = m_pages[chunkIdx * sk_chunkPageNum + i];
+			page.m_next = m_freePages;
+			m_freePages = &page;
+		}
+	}
+
+	Page* page = m_freePages;
+	m_freePages = page->m_next;
+	page->m_next = nullptr;
+
+	const size_t chunkIdx = static_cast<size_t>(page - m_pages) / sk_chunkPageNum;
+	--m_chunks[chunkIdx].m_freePageNum;
+	if (chunkIdx == m_spareChunk)
+	{
+		m_spareChunk = sk_maxChunkNum;
+	}
+	return page;
+}
+
+void MemoryPool::GiveBackPage(Page * page) noexcept
+{
+	SpinLockGuard arenaLock(m_arenaLock);
+
+	const size_t chunkIdx = static_cast<size_t>(page - m_pages) / sk_chunkPageNum;
+	Chunk& chunk = m_chunks[chunkIdx];
+	page->m_next = m_freePages;
+	m_freePages = page;
+	if (++chunk.m_freePageNum < sk_chunkPageNum)
+	{
+		return;
+	}
+
+	//All pages of the chunk are free. One such chunk is kept spare, so that a page taken and given
+	//	back over and over doesn't take a chunk from the heap each time.
+	if (m_spareChunk == sk_maxChunkNum)
+	{
+		m_spareChunk = chunkIdx;
+		return;
+	}
+
+	//Otherwise its pages are taken out of the free list, and it goes back to the heap.
+	Page** it = &m_freePages;
+	while (*it != nullptr)
+	{
+		if (static_cast<size_t>(*it - m_pages) / sk_chunkPageNum == chunkIdx)
+		{
+			*it = (*it)->m_next;
+		}
+		else
+		{
+			it = &(*it)->m_next;
+		}
+	}
+
+	void* chunkMem = reinterpret_cast<void*>(chunk.m_begin.load(std::memory_order_relaxed));
+	chunk.m_begin.store(0, std::memory_order_release);
+	chunk.m_freePageNum = 0;
+	m_reserved.fetch_sub(sk_chunkSize, std::memory_order_relaxed);
+	std::free(chunkMem);
+}
+
+void MemoryPool::AddReserved(uint64_t size) noexcept
+{
+	UpdatePeak(m_peakReserved, m_reserved.fetch_add(size, std::memory_order_relaxed) + size);
+}
+
+void MemoryPool::SampleStack() noexcept
+{
+	//Sampled at every allocation, which happens throughout a handshake; the spread from the shallowest
+	//allocation down to the deepest one is a lower bound of the stack used. Frames above the shallowest
+	//allocation (i.e. the ECALL entry) and below the deepest one are not seen.
+	volatile uint8_t marker = 0;
+	const uintptr_t sp = reinterpret_cast<uintptr_t>(&marker);
+
+	if (sp > gs_stackTop)
+	{
+		gs_stackTop = sp;
+	}
+	if (sp < gs_stackLow)
+	{
+		gs_stackLow = sp;
+	}
+	UpdatePeak(m_peakStack, gs_stackTop - gs_stackLow);
+}
+
+MemoryPool & ServerEnclave::GetMemoryPool() noexcept
+{
+	return gs_memoryPool;
+}
+
+void* operator new(std::size_t size)
+{
+	void* ptr = gs_memoryPool.Allocate(size);
+	if (ptr == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return gs_memoryPool.Allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return gs_memoryPool.Allocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	gs_memoryPool.Deallocate(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	gs_memoryPool.Deallocate(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+	gs_memoryPool.Deallocate(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+	gs_memoryPool.Deallocate(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	gs_memoryPool.Deallocate(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+	gs_memoryPool.Deallocate(ptr);
+}
+
+extern "C" void ecall_decent_server_heap_stats(uint64_t* out_in_use, uint64_t* out_peak_in_use, uint64_t* out_reserved,
+	uint64_t* out_peak_reserved, uint64_t* out_failed, uint64_t* out_peak_stack)
+{
+	const HeapStats stats = gs_memoryPool.GetStats();
+	*out_in_use = stats.m_inUse;
+	*out_peak_in_use = stats.m_peakInUse;
+	*out_reserved = stats.m_reserved;
+	*out_peak_reserved = stats.m_peakReserved;
+	*out_failed = stats.m_failedCnt;
+	*out_peak_stack = stats.m_peakStack;
+}
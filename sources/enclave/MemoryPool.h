@@ -0,0 +1,195 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Decent
+{
+	namespace ServerEnclave
+	{
+		struct HeapStats
+		{
+			uint64_t m_inUse;
+			uint64_t m_peakInUse;
+			uint64_t m_reserved;
+			uint64_t m_peakReserved;
+			uint64_t m_failedCnt;
+			uint64_t m_peakStack;
+		};
+
+		/**
+		 * \brief	The allocator behind the global operator new of the enclave.
+		 *
+		 * 			Small objects (up to sk_maxClassSize bytes) are rounded up to fixed size classes, and
+		 * 			carved from pages of sk_pageSize bytes, each holding blocks of one class only. Blocks
+		 * 			have no header: pages are taken from the heap in chunks of sk_chunkSize bytes, and
+		 * 			the pool keeps the address of every chunk, so the page (and the class) of a block is
+		 * 			found from its address. Freed blocks go back to their page, so the short-lived
+		 * 			objects of the handshakes (certificate buffers, RPC messages) keep reusing the same
+		 * 			pages. A page whose blocks are all free can serve another class, and a chunk whose
+		 * 			pages are all free goes back to the heap (except one kept spare), so that it can
+		 * 			serve mbedTLS or a large allocation. Larger objects, and small ones once sk_maxChunkNum chunks are taken, go
+		 * 			straight to the heap behind a 16-byte header. mbedTLS allocates with its own calloc,
+		 * 			so its contexts are not pooled.
+		 *
+		 * 			It also keeps high-water marks of heap usage, and a lower bound of the stack usage,
+		 * 			so that the heap size and the stack size in Enclave.config.xml can be set from
+		 * 			measurements. The stack size still needs a margin above it.
+		 */
+		class MemoryPool
+		{
+		public:
+			static constexpr size_t sk_minClassSize = 32;
+			static constexpr size_t sk_maxClassSize = 4096;
+			static constexpr size_t sk_classNum = 8; //32, 64, ..., 4096.
+			static constexpr size_t sk_pageSize = 4096;
+			static constexpr size_t sk_chunkSize = 32 * 1024;
+			/** \brief	The most chunks taken at the same time; they are looked up one by one. */
+			static constexpr size_t sk_maxChunkNum = 16;
+
+		public:
+			constexpr MemoryPool() noexcept :
+				m_classes(),
+				m_arenaLock(false),
+				m_chunks(),
+				m_chunkNum(0),
+				m_pages(),
+				m_freePages(nullptr),
+				m_spareChunk(sk_maxChunkNum),
+				m_inUse(0),
+				m_peakInUse(0),
+				m_reserved(0),
+				m_peakReserved(0),
+				m_failedCnt(0),
+				m_peakStack(0)
+			{}
+
+			MemoryPool(const MemoryPool& rhs) = delete;
+
+			/**
+			 * \brief	Allocates memory, aligned the same as malloc does.
+			 *
+			 * \param	size	The size.
+			 *
+			 * \return	The memory, or nullptr if the heap is exhausted.
+			 */
+			void* Allocate(size_t size) noexcept;
+
+			/**
+			 * \brief	Frees memory from Allocate.
+			 *
+			 * \param [in]	ptr	The memory; may be nullptr.
+			 */
+			void Deallocate(void* ptr) noexcept;
+
+			HeapStats GetStats() const noexcept;
+
+		private:
+			static constexpr size_t sk_chunkPageNum = sk_chunkSize / sk_pageSize;
+
+			struct LargeHeader;
+			struct FreeBlock;
+
+			struct Page
+			{
+				constexpr Page() noexcept :
+					m_freeList(nullptr),
+					m_carvedNum(0),
+					m_usedNum(0),
+					m_classIdx(0),
+					m_prev(nullptr),
+					m_next(nullptr)
+				{}
+
+				FreeBlock* m_freeList;
+				size_t m_carvedNum; //Blocks are carved in order, when the free list is empty.
+				size_t m_usedNum;
+				size_t m_classIdx;
+				Page* m_prev; //In the list of the pages of a class with room, or
+				Page* m_next; //	in the list of free pages (m_next only).
+			};
+
+			struct Chunk
+			{
+				constexpr Chunk() noexcept :
+					m_begin(0),
+					m_freePageNum(0)
+				{}
+
+				std::atomic<uintptr_t> m_begin; //Zero if the slot is not taken.
+				size_t m_freePageNum;
+			};
+
+			struct SizeClass
+			{
+				constexpr SizeClass() noexcept :
+					m_lock(false),
+					m_roomyPages(nullptr)
+				{}
+
+				std::atomic<bool> m_lock; //A spin lock; it's only held to take or give back one block.
+				Page* m_roomyPages;       //Pages with at least one block not in use.
+			};
+
+			static size_t GetClassIndex(size_t size) noexcept;
+
+			static size_t GetClassSize(size_t classIdx) noexcept;
+
+			static size_t GetPageBlockNum(size_t classIdx) noexcept;
+
+			/**
+			 * \brief	Finds the page a block is in.
+			 *
+			 * \return	The page, or nullptr if the block is not in any chunk.
+			 */
+			Page* FindPage(const void* ptr) noexcept;
+
+			uint8_t* GetPageMemory(const Page* page) const noexcept;
+
+			void* AllocateFromClass(size_t classIdx) noexcept;
+
+			void DeallocateToPage(Page* page, void* ptr) noexcept;
+
+			/**
+			 * \brief	Takes a free page, taking a new chunk from the heap if there is none.
+			 *
+			 * \return	The page, or nullptr if no chunk can be taken.
+			 */
+			Page* TakeFreePage() noexcept;
+
+			/**
+			 * \brief	Gives a page back. Its chunk goes back to the heap once all its pages are free,
+			 * 			unless it's kept as the spare chunk.
+			 */
+			void GiveBackPage(Page* page) noexcept;
+
+			void AddReserved(uint64_t size) noexcept;
+
+			void SampleStack() noexcept;
+
+			SizeClass m_classes[sk_classNum];
+
+			std::atomic<bool> m_arenaLock; //A spin lock for the chunks and the free pages.
+			Chunk m_chunks[sk_maxChunkNum];
+			std::atomic<size_t> m_chunkNum; //Slots in use are all below it, so lookups stop there.
+			Page m_pages[sk_maxChunkNum * sk_chunkPageNum];
+			Page* m_freePages;
+			size_t m_spareChunk; //A chunk with all pages free, kept from the heap; sk_maxChunkNum if none.
+
+			std::atomic<uint64_t> m_inUse;
+			std::atomic<uint64_t> m_peakInUse;
+			std::atomic<uint64_t> m_reserved;
+			std::atomic<uint64_t> m_peakReserved;
+			std::atomic<uint64_t> m_failedCnt;
+			std::atomic<uint64_t> m_peakStack;
+		};
+
+		/**
+		 * \brief	Gets the memory pool of this enclave.
+		 *
+		 * \return	The memory pool.
+		 */
+		MemoryPool& GetMemoryPool() noexcept;
+	}
+}